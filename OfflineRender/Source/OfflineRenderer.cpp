@@ -0,0 +1,508 @@
+#include "OfflineRenderer.h"
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/Score.h"
+#include "../../Source/ScoreCache.h"
+
+namespace
+{
+    // Stands in for the host, playing from the position set before each block
+    struct RenderPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override { return info; }
+        PositionInfo info;
+    };
+
+    // A decaying sine per note. A voice is a phasor, its gain folded in, that turns and decays
+    // by the same step every sample until its note-off. Each voice keeps a table of that step's
+    // powers, built when the note starts and again when it ends, so a chunk of samples is the
+    // phasor times the table - the samples do not depend on each other and the loop has no sin()
+    // in it. Active voices are packed at the front and freed once they have decayed to silence
+    class ToneSynth
+    {
+    public:
+        static constexpr int maxVoices = 64;
+
+        explicit ToneSynth(double newSampleRate)
+            : sampleRate(newSampleRate),
+              decay(std::exp(-1.0 / (decaySeconds * newSampleRate))),
+              release(std::exp(-1.0 / (releaseSeconds * newSampleRate))),
+              powersRe((size_t) (maxVoices * tableSize)),
+              powersIm((size_t) (maxVoices * tableSize))
+        {
+            for (int voice = 0; voice < maxVoices; ++voice)
+            {
+                tables[(size_t) voice] = voice;
+                clearVoice(voice);
+            }
+        }
+
+        void noteOn(int channel, int noteNumber, float velocity)
+        {
+            // A free voice, or else the quietest
+            int voice = numActive;
+            if (numActive < maxVoices)
+                ++numActive;
+            else
+                for (int other = voice = 0; other < maxVoices; ++other)
+                    if (getLevel(other) < getLevel(voice))
+                        voice = other;
+
+            double frequency = 440.0 * std::pow(2.0, (noteNumber - 69) / 12.0);
+
+            channels[(size_t) voice] = channel;
+            noteNumbers[(size_t) voice] = noteNumber;
+            re[(size_t) voice] = 0.25f * velocity;
+            im[(size_t) voice] = 0.0f;
+            steps[(size_t) voice] = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+            fillPowers(voice, decay);
+        }
+
+        void noteOff(int channel, int noteNumber)
+        {
+            for (int voice = 0; voice < numActive; ++voice)
+                if (channels[(size_t) voice] == channel && noteNumbers[(size_t) voice] == noteNumber)
+                    fillPowers(voice, release);
+        }
+
+        // Adds to output
+        void render(float* output, int numSamples)
+        {
+            if (numActive == 0)
+                return;
+
+            for (int start = 0; start < numSamples; start += chunkSamples)
+            {
+                int length = juce::jmin(chunkSamples, numSamples - start);
+                for (size_t voice = 0; voice < (size_t) numActive; ++voice)
+                {
+                    const float* tableRe = powersRe.data() + (size_t) tables[voice] * tableSize;
+                    const float* tableIm = powersIm.data() + (size_t) tables[voice] * tableSize;
+                    float phasorRe = re[voice], phasorIm = im[voice];
+
+                    for (int i = 0; i < length; ++i)
+                        output[start + i] += phasorRe * tableIm[i] + phasorIm * tableRe[i];
+
+                    re[voice] = phasorRe * tableRe[length] - phasorIm * tableIm[length];
+                    im[voice] = phasorRe * tableIm[length] + phasorIm * tableRe[length];
+                }
+
+                // Silent voices are replaced by the last active one
+                for (int voice = 0; voice < numActive;)
+                {
+                    if (getLevel(voice) >= silence * silence)
+                    {
+                        ++voice;
+                        continue;
+                    }
+
+                    --numActive;
+                    moveVoice(numActive, voice);
+                    clearVoice(numActive);
+                }
+            }
+        }
+
+    private:
+        static constexpr int chunkSamples = 256;
+        static constexpr int tableSize = chunkSamples + 1;
+        static constexpr double decaySeconds = 0.15;
+        static constexpr double releaseSeconds = 0.02;
+        static constexpr float silence = 1.0e-4f;
+
+        float getLevel(int voice) const
+        {
+            return re[(size_t) voice] * re[(size_t) voice] + im[(size_t) voice] * im[(size_t) voice];
+        }
+
+        // The voice's step to the power of 0 to chunkSamples, turning by its frequency and
+        // decaying by the given per-sample multiplier. Stepped in double so the table stays exact
+        void fillPowers(int voice, double multiplier)
+        {
+            auto* tableRe = powersRe.data() + (size_t) tables[(size_t) voice] * tableSize;
+            auto* tableIm = powersIm.data() + (size_t) tables[(size_t) voice] * tableSize;
+            double stepRe = multiplier * std::cos(steps[(size_t) voice]), stepIm = multiplier * std::sin(steps[(size_t) voice]);
+            double powerRe = 1.0, powerIm = 0.0;
+
+            for (int i = 0; i < tableSize; ++i)
+            {
+                tableRe[i] = (float) powerRe;
+                tableIm[i] = (float) powerIm;
+
+                double nextRe = powerRe * stepRe - powerIm * stepIm;
+                powerIm = powerRe * stepIm + powerIm * stepRe;
+                powerRe = nextRe;
+            }
+        }
+
+        // The voices swap tables, so each keeps one of its own
+        void moveVoice(int from, int to)
+        {
+            channels[(size_t) to] = channels[(size_t) from];
+            noteNumbers[(size_t) to] = noteNumbers[(size_t) from];
+            re[(size_t) to] = re[(size_t) from];
+            im[(size_t) to] = im[(size_t) from];
+            steps[(size_t) to] = steps[(size_t) from];
+            std::swap(tables[(size_t) to], tables[(size_t) from]);
+        }
+
+        // Silent until its next note
+        void clearVoice(int voice)
+        {
+            channels[(size_t) voice] = 0;
+            noteNumbers[(size_t) voice] = -1;
+            re[(size_t) voice] = 0.0f;
+            im[(size_t) voice] = 0.0f;
+            steps[(size_t) voice] = 0.0;
+        }
+
+        double sampleRate;
+        double decay, release;      // Per-sample gain multipliers
+        int numActive = 0;
+
+        std::array<int, maxVoices> channels, noteNumbers, tables;
+        std::array<float, maxVoices> re, im;
+        std::array<double, maxVoices> steps;       // Radians per sample
+        std::vector<float> powersRe, powersIm;     // tableSize per table
+    };
+
+    // The audio, synthesised and written on the writer thread while the processor plays. The
+    // render thread hands over the notes of each block it has played, so only notes cross between
+    // the threads; there is no audio queue for the render to fill and wait on
+    class AudioPass : public juce::TimeSliceClient
+    {
+    public:
+        struct Note
+        {
+            juce::int64 sample;
+            int channel, noteNumber;
+            float velocity;             // 0 for a note-off
+        };
+
+        AudioPass(juce::AudioFormatWriter* newWriter, double sampleRate)
+            : writer(newWriter), synth(sampleRate), audio(1, chunkSamples) {}
+
+        // Render thread. The notes are in order and before playedTo
+        void addBlock(const std::vector<Note>& blockNotes, juce::int64 newPlayedTo)
+        {
+            const juce::ScopedLock sl(lock);
+            pending.insert(pending.end(), blockNotes.begin(), blockNotes.end());
+            playedTo = newPlayedTo;
+        }
+
+        // Render thread, after the last block. Blocks until the writer has written it
+        void finish()
+        {
+            {
+                const juce::ScopedLock sl(lock);
+                finished = true;
+            }
+            written.wait(-1);
+        }
+
+        int useTimeSlice() override
+        {
+            juce::int64 end;
+            bool last;
+            {
+                const juce::ScopedLock sl(lock);
+                notes.insert(notes.end(), pending.begin(), pending.end());
+                pending.clear();
+                end = playedTo;
+                last = finished;
+            }
+
+            if (writtenTo == end)
+            {
+                if (last)
+                    written.signal();
+                return 1;
+            }
+
+            // A chunk per slice, so jobs sharing the writer thread take turns
+            int length = (int) juce::jmin((juce::int64) chunkSamples, end - writtenTo);
+            auto* output = audio.getWritePointer(0);
+            int renderedTo = 0;
+            audio.clear();
+
+            for (; nextNote < notes.size() && notes[nextNote].sample < writtenTo + length; ++nextNote)
+            {
+                const auto& note = notes[nextNote];
+                int offset = (int) (note.sample - writtenTo);
+                synth.render(output + renderedTo, offset - renderedTo);
+                renderedTo = offset;
+
+                if (note.velocity > 0.0f)
+                    synth.noteOn(note.channel, note.noteNumber, note.velocity);
+                else
+                    synth.noteOff(note.channel, note.noteNumber);
+            }
+
+            synth.render(output + renderedTo, length - renderedTo);
+            writer->writeFromFloatArrays(audio.getArrayOfReadPointers(), 1, length);
+            writtenTo += length;
+
+            if (nextNote == notes.size())
+            {
+                notes.clear();
+                nextNote = 0;
+            }
+
+            return 0;
+        }
+
+    private:
+        static constexpr int chunkSamples = 16384;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        ToneSynth synth;
+        juce::AudioBuffer<float> audio;
+
+        juce::CriticalSection lock;
+        std::vector<Note> pending;      // Handed over, guarded by lock
+        juce::int64 playedTo = 0;
+        bool finished = false;
+
+        std::vector<Note> notes;        // Writer thread only
+        size_t nextNote = 0;
+        juce::int64 writtenTo = 0;
+        juce::WaitableEvent written;
+    };
+}
+
+//==============================================================================
+bool OfflineRenderer::loadPlayersFromCSV(const juce::File& csvFile, juce::Array<Player>& players, juce::String& error)
+{
+    juce::StringArray lines;
+    csvFile.readLines(lines);
+    lines.removeEmptyStrings();
+
+    players.clear();
+    for (int line = 1; line < lines.size(); ++line)     // The first line is the header
+    {
+        auto fields = juce::StringArray::fromTokens(lines[line], ",", "");
+        if (fields.size() < 15)
+        {
+            error = csvFile.getFileName() + " line " + juce::String(line + 1) + ": expected 15 fields";
+            return false;
+        }
+
+        std::array<double, 4> alphas, betas;
+        for (int i = 0; i < 4; ++i)
+        {
+            alphas[(size_t) i] = fields[7 + i].getDoubleValue();
+            betas[(size_t) i] = fields[11 + i].getDoubleValue();
+        }
+
+        players.add(Player(fields[0].getIntValue(), fields[1].getIntValue() != 0, fields[2].getIntValue(),
+                           fields[3].getFloatValue(), fields[4].getFloatValue(),
+                           fields[5].getFloatValue(), fields[6].getFloatValue(), alphas, betas));
+    }
+
+    if (players.isEmpty())
+    {
+        error = csvFile.getFileName() + " has no players";
+        return false;
+    }
+
+    return true;
+}
+
+OfflineRenderer::Result OfflineRenderer::render(const Job& job, juce::TimeSliceThread& writerThread)
+{
+    Result result;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // Jobs on the same score share one compiled copy with their processors
+    juce::SharedResourcePointer<ScoreCache> scoreCache;
+    auto score = scoreCache->acquire(job.scoreFile, ScoreCompiler::defaultChordToleranceMs);
+    if (score == nullptr || score->getNumOnsets() == 0)
+    {
+        scoreCache->release(score);
+        result.message = "Could not load " + job.scoreFile.getFileName();
+        return result;
+    }
+
+    AdaptiveMetronomeAudioProcessor processor;
+    processor.setPredictiveScheduling(job.predictiveScheduling);
+    processor.setSinglePrecisionModel(job.singlePrecision);
+    processor.UpdatePlayers(job.players);
+    processor.prepareToPlay(job.sampleRate, job.blockSize);
+    processor.loadScore(job.scoreFile);
+
+    // User players tap on their nominal onsets, give or take the tap noise. The seed is fixed so
+    // predictive and reactive renders of a job get the same taps
+    TempoMap tempoMap = score->tempoMap;
+    tempoMap.prepare(job.sampleRate);
+
+    juce::Random random(1);
+    std::vector<std::pair<juce::int64, int>> taps;
+    juce::int64 lastNoteOff = 0;
+    for (int onset = 0; onset < score->getNumOnsets(); ++onset)
+    {
+        auto onsetSample = tempoMap.tickToSample(score->onsets[(size_t) onset].tick);
+        for (const auto& player : job.players)
+        {
+            if (!player.getIsUser() || !score->hasChannel(onset, player.getMidiChannel()))
+                continue;
+
+            // Box-Muller
+            double noise = std::sqrt(-2.0 * std::log(1.0 - random.nextDouble())) * std::cos(juce::MathConstants<double>::twoPi * random.nextDouble());
+            auto tapSample = (juce::int64) (onsetSample + noise * job.tapNoiseMs * 0.001 * job.sampleRate);
+            taps.push_back({ juce::jmax((juce::int64) 0, tapSample), player.getMidiChannel() });
+        }
+    }
+    std::sort(taps.begin(), taps.end());
+
+    for (const auto& note : score->notes)
+        lastNoteOff = juce::jmax(lastNoteOff, (juce::int64) tempoMap.tickToSample(note.offTick));
+
+    scoreCache->release(score);    // The processor keeps its own reference
+
+    std::unique_ptr<AudioPass> audioPass;
+    if (job.wavFile != juce::File())
+    {
+        job.wavFile.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream = job.wavFile.createOutputStream();
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        if (stream != nullptr)
+            writer.reset(juce::WavAudioFormat().createWriterFor(stream.get(), job.sampleRate, 1, 24, {}, 0));
+
+        if (writer == nullptr)
+        {
+            result.message = "Could not write " + job.wavFile.getFullPathName();
+            return result;
+        }
+
+        stream.release();   // Owned by the writer now
+        audioPass = std::make_unique<AudioPass>(writer.release(), job.sampleRate);
+        writerThread.addTimeSliceClient(audioPass.get());
+    }
+
+    RenderPlayHead playHead;
+    playHead.info.setIsPlaying(true);
+    processor.setPlayHead(&playHead);
+
+    juce::AudioBuffer<float> processorBuffer(2, job.blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(65536);
+    juce::MidiMessageSequence sequence;
+    std::vector<AudioPass::Note> blockNotes;
+
+    // The ensemble can drift later than the score, so the render runs until a tail with no new notes
+    auto tailSamples = (juce::int64) (job.tailSeconds * job.sampleRate);
+    auto maxSamples = 2 * lastNoteOff + tailSamples;
+    juce::int64 lastNoteOn = 0;
+
+    size_t nextTap = 0;
+    for (juce::int64 position = 0; position < maxSamples; position += job.blockSize)
+    {
+        if (position >= lastNoteOff + tailSamples && position >= lastNoteOn + tailSamples)
+            break;
+
+        processorBuffer.clear();
+        midi.clear();
+        for (; nextTap < taps.size() && taps[nextTap].first < position + job.blockSize; ++nextTap)
+            midi.addEvent(juce::MidiMessage::noteOn(taps[nextTap].second, 60, (juce::uint8) 100),
+                          (int) juce::jmax((juce::int64) 0, taps[nextTap].first - position));
+
+        playHead.info.setTimeInSamples(position);
+        processor.processBlock(processorBuffer, midi);
+
+        blockNotes.clear();
+        for (const auto metadata : midi)
+        {
+            auto message = metadata.getMessage();
+            if (message.isNoteOn() || message.isNoteOff())
+                blockNotes.push_back({ position + metadata.samplePosition, message.getChannel(), message.getNoteNumber(),
+                                       message.isNoteOn() ? message.getFloatVelocity() : 0.0f });
+
+            if (message.isNoteOn())
+            {
+                lastNoteOn = position + metadata.samplePosition;
+                ++result.numNotes;
+            }
+
+            // Milliseconds, to match the file's SMPTE time format below
+            message.setTimeStamp((double) (position + metadata.samplePosition) * 1000.0 / job.sampleRate);
+            sequence.addEvent(message);
+        }
+
+        if (audioPass != nullptr)
+            audioPass->addBlock(blockNotes, position + job.blockSize);
+
+        result.performanceSeconds = (double) (position + job.blockSize) / job.sampleRate;
+    }
+
+    processor.setPlayHead(nullptr);
+
+    if (audioPass != nullptr)
+    {
+        audioPass->finish();
+        writerThread.removeTimeSliceClient(audioPass.get());
+        audioPass.reset();      // Closes the file
+    }
+
+    if (job.midiFile != juce::File())
+    {
+        juce::MidiFile midiFile;
+        midiFile.setSmpteTimeFormat(25, 40);    // 1000 ticks per second
+        sequence.updateMatchedPairs();
+        midiFile.addTrack(sequence);
+
+        job.midiFile.deleteFile();
+        juce::FileOutputStream stream(job.midiFile);
+        if (!stream.openedOk() || !midiFile.writeTo(stream))
+        {
+            result.message = "Could not write " + job.midiFile.getFullPathName();
+            return result;
+        }
+    }
+
+    result.numOnsets = (int) processor.getAsynchronyStatistics().getSnapshot().numOnsets;
+    result.scheduling = processor.getSchedulingStatistics().getSnapshot();
+    result.renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    result.succeeded = true;
+    result.message = job.scoreFile.getFileName() + ": " + juce::String(result.performanceSeconds, 1) + " s rendered in "
+                     + juce::String(result.renderSeconds * 1000.0, 1) + " ms, " + juce::String(result.numOnsets) + " onsets, "
+                     + juce::String(result.numNotes) + " notes" + (job.singlePrecision ? " (float model); " : "; ")
+                     + (job.predictiveScheduling ? "predictive" : "reactive") + " scheduling: prediction error "
+                     + juce::String(result.scheduling.meanPredictionErrorMs, 2) + " +/- " + juce::String(result.scheduling.predictionErrorSDMs, 2)
+                     + " ms, " + juce::String(result.scheduling.numLateOnsets) + " of " + juce::String(result.scheduling.numComputerOnsets)
+                     + " computer onsets late (max " + juce::String(result.scheduling.maxResponseLatencyMs, 1) + " ms), "
+                     + juce::String(result.scheduling.numLateCorrections) + " late corrections";
+    return result;
+}
+
+juce::Array<OfflineRenderer::Result> OfflineRenderer::renderAll(const juce::Array<Job>& jobs, int numThreads)
+{
+    juce::Array<Result> results;
+    results.resize(jobs.size());
+
+    // A writer thread per render thread, so the audio passes run in parallel too
+    int numRenderThreads = numThreads > 0 ? numThreads : juce::SystemStats::getNumCpus();
+    juce::OwnedArray<juce::TimeSliceThread> writerThreads;
+    for (int i = 0; i < numRenderThreads; ++i)
+    {
+        auto* writerThread = writerThreads.add(new juce::TimeSliceThread("Render Writer " + juce::String(i + 1)));
+        writerThread->startThread();
+    }
+
+    {
+        juce::ThreadPool pool(numRenderThreads);
+        for (int i = 0; i < jobs.size(); ++i)
+        {
+            auto& writerThread = *writerThreads[i % numRenderThreads];
+            pool.addJob([&jobs, &results, &writerThread, i]
+                {
+                    results.getReference(i) = render(jobs.getReference(i), writerThread);
+                });
+        }
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(5);
+    }
+
+    for (auto* writerThread : writerThreads)
+        writerThread->stopThread(1000);
+    return results;
+}
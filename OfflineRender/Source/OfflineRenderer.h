@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/Player.h"
+#include "../../Source/SchedulingStatistics.h"
+
+//==============================================================================
+// OfflineRenderer - plays a score through AdaptiveMetronomeAudioProcessor without a host, as
+// fast as the CPU allows, and writes the performance as a WAV file and a MIDI file.
+//
+// The processor only outputs MIDI, so the audio is a simple decaying tone per note, enough
+// to hear the timing, and only synthesised for jobs with a wavFile. User players tap on their nominal onsets, as in the real-time check, or
+// scattered around them to see how the scheduling copes. Audio is synthesised and written on a writer thread while the processor plays.
+class OfflineRenderer
+{
+public:
+    struct Job
+    {
+        juce::File scoreFile;
+        juce::Array<Player> players;
+        juce::File wavFile;                 // Skipped when empty
+        juce::File midiFile;                // Skipped when empty
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        double tailSeconds = 2.0;           // After the last note-off
+        bool predictiveScheduling = true;
+        double tapNoiseMs = 0.0;            // Standard deviation of the user taps around their nominal onsets
+        bool singlePrecision = false;       // Plays the ensemble on FloatEnsembleModel
+    };
+
+    struct Result
+    {
+        bool succeeded = false;
+        juce::String message;
+        double performanceSeconds = 0.0;
+        double renderSeconds = 0.0;
+        int numOnsets = 0;
+        int numNotes = 0;
+        SchedulingStatistics::Snapshot scheduling;
+    };
+
+    // Reads players in the layout AdaptiveMetronomeAudioProcessor::ExportPlayersToCSV writes
+    static bool loadPlayersFromCSV(const juce::File& csvFile, juce::Array<Player>& players, juce::String& error);
+
+    // Jobs with a wavFile are synthesised and written on writerThread, which they take turns on when shared
+    static Result render(const Job& job, juce::TimeSliceThread& writerThread);
+
+    // Renders every job, numThreads at a time (0 for one per core). Results are in job order
+    static juce::Array<Result> renderAll(const juce::Array<Job>& jobs, int numThreads);
+};
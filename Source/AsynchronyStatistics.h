@@ -0,0 +1,197 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+// Summary of the asynchronies of player i relative to player j, in ms
+struct PairSummary
+{
+    juce::int64 count = 0;
+    float mean = 0.0f;          // Whole performance (Welford)
+    float sd = 0.0f;
+    float windowMean = 0.0f;    // Last AsynchronyStatistics::windowSize onsets
+    float windowSD = 0.0f;
+    float lag1 = 0.0f;          // Lag-1 autocorrelation over the whole performance
+};
+
+//==============================================================================
+// AsynchronyStatistics - live synchrony metrics updated once per score onset from the
+// audio thread. The accumulators form a fixed maxPlayers x maxPlayers matrix indexed like the
+// alpha/beta grid (row = player, column = the player it is compared with), so an update is
+// O(N^2) and never allocates.
+//
+// Results are published through a sequence lock: the editor or an OSC sender copy a snapshot
+// with getSnapshot() without ever blocking the audio thread.
+class AsynchronyStatistics
+{
+public:
+    static constexpr int maxPlayers = 4;
+    static constexpr int windowSize = 32;
+
+    struct Snapshot
+    {
+        std::array<std::array<PairSummary, maxPlayers>, maxPlayers> pairs {};
+        juce::int64 numOnsets = 0;
+    };
+
+    // Clears everything. Not to be called while the audio thread is adding onsets
+    void reset()
+    {
+        accumulators = {};
+        numOnsets = 0;
+        publish();
+    }
+
+    // The next onset is not a continuation of the last (transport jump), so lag-1 pairs restart
+    void markDiscontinuity()
+    {
+        for (auto& row : accumulators)
+            for (auto& pair : row)
+                pair.hasPrevious = false;
+    }
+
+    // Adds one score onset. onsetsMs holds each player's onset, and playedMask has bit i set
+    // for every player that actually played it - pairs are only updated when both did
+    void addOnset(const double* onsetsMs, int numPlayers, juce::uint32 playedMask)
+    {
+        ++numOnsets;
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            if ((playedMask & (1u << i)) == 0)
+                continue;
+
+            for (int j = 0; j < numPlayers; ++j)
+                if (j != i && (playedMask & (1u << j)) != 0)
+                    accumulators[(size_t) i][(size_t) j].add(onsetsMs[i] - onsetsMs[j]);
+        }
+
+        publish();
+    }
+
+    // Lock-free copy of the latest results, safe from any thread
+    Snapshot getSnapshot() const
+    {
+        Snapshot copy;
+        for (;;)
+        {
+            auto before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0)
+            {
+                copy = published;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before)
+                    return copy;
+            }
+        }
+    }
+
+private:
+    struct alignas(64) PairAccumulator
+    {
+        // Welford running mean and sum of squared deviations
+        juce::int64 count = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+
+        // Sums for the lag-1 autocorrelation
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        double lagProducts = 0.0;   // Sum of x[t] * x[t - 1] over consecutive pairs
+        double lagHeadSum = 0.0;    // Sum of the x[t] that have a predecessor
+        double lagTailSum = 0.0;    // Sum of the x[t - 1] that have a successor
+        juce::int64 lagCount = 0;
+        double previous = 0.0;
+        bool hasPrevious = false;
+
+        // Ring buffer of the last windowSize values
+        std::array<double, windowSize> window {};
+        int windowCount = 0;
+        int windowIndex = 0;
+        double windowSum = 0.0;
+        double windowSumSquares = 0.0;
+
+        void add(double x)
+        {
+            ++count;
+            double delta = x - mean;
+            mean += delta / (double) count;
+            m2 += delta * (x - mean);
+
+            sum += x;
+            sumSquares += x * x;
+            if (hasPrevious)
+            {
+                lagProducts += x * previous;
+                lagHeadSum += x;
+                lagTailSum += previous;
+                ++lagCount;
+            }
+            previous = x;
+            hasPrevious = true;
+
+            if (windowCount == windowSize)
+            {
+                double oldest = window[(size_t) windowIndex];
+                windowSum -= oldest;
+                windowSumSquares -= oldest * oldest;
+            }
+            else
+            {
+                ++windowCount;
+            }
+
+            window[(size_t) windowIndex] = x;
+            windowIndex = (windowIndex + 1) % windowSize;
+            windowSum += x;
+            windowSumSquares += x * x;
+        }
+
+        PairSummary summarise() const
+        {
+            PairSummary summary;
+            summary.count = count;
+            summary.mean = (float) mean;
+            summary.sd = count > 1 ? (float) std::sqrt(m2 / (double) (count - 1)) : 0.0f;
+
+            if (windowCount > 0)
+            {
+                double windowMean = windowSum / windowCount;
+                double windowVariance = windowCount > 1 ? (windowSumSquares - windowSum * windowMean) / (windowCount - 1) : 0.0;
+                summary.windowMean = (float) windowMean;
+                summary.windowSD = (float) std::sqrt(juce::jmax(0.0, windowVariance));
+            }
+
+            // Sum of (x[t] - mean)(x[t - 1] - mean) over the sum of (x[t] - mean)^2
+            double denominator = sumSquares - sum * mean;
+            if (lagCount > 0 && denominator > 0.0)
+            {
+                double numerator = lagProducts - mean * (lagHeadSum + lagTailSum) + (double) lagCount * mean * mean;
+                summary.lag1 = (float) juce::jlimit(-1.0, 1.0, numerator / denominator);
+            }
+
+            return summary;
+        }
+    };
+
+    void publish()
+    {
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < (size_t) maxPlayers; ++i)
+            for (size_t j = 0; j < (size_t) maxPlayers; ++j)
+                published.pairs[i][j] = accumulators[i][j].summarise();
+        published.numOnsets = numOnsets;
+
+        sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    std::array<std::array<PairAccumulator, maxPlayers>, maxPlayers> accumulators {};
+    juce::int64 numOnsets = 0;
+
+    alignas(64) Snapshot published;
+    alignas(64) std::atomic<juce::uint32> sequence { 0 };
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "NoteOffWheel.h"
+#include "Player.h"
+#include "Score.h"
+#include "TempoMap.h"
+
+//==============================================================================
+// ComputerNotes - the notes a computer player sends for a score onset, for the main ensemble
+// and the group ensembles alike. The player's part is read from its own channel and its notes
+// go out channelOffset channels from there, 0 for the main ensemble.
+//
+// Audio thread, or the worker playing a group ensemble. Nothing here allocates.
+namespace ComputerNotes
+{
+    // Adds the player's notes for the onset to outputMidi and schedules their note-offs. Note
+    // lengths are stretched by the player's period over the reference period, so they follow the
+    // ensemble's tempo. Onsets that could only be computed after their send time go out at the
+    // start of the block. Returns the sample the notes went out at
+    inline juce::int64 send(const CompiledScore& score, const TempoMap& tempoMap, const Player& player, int channelOffset,
+                            double stretch, int onsetIndex, double sendTime, juce::int64 blockStart, int numSamples,
+                            NoteOffWheel& noteOffs, juce::MidiBuffer& outputMidi)
+    {
+        int scoreChannel = player.getMidiChannel();
+        int channel = scoreChannel + channelOffset;
+
+        int offset = juce::jlimit(0, numSamples - 1, (int) ((juce::int64) std::floor(sendTime) - blockStart));
+        juce::int64 sendSample = blockStart + offset;
+
+        for (const auto& note : score.getChannelNotes(onsetIndex, scoreChannel))
+        {
+            float velocity = note.velocity / 127.0f * player.getVolume();
+            if (velocity < 1.0f / 127.0f)
+                continue;
+
+            outputMidi.addEvent(juce::MidiMessage::noteOn(channel, note.noteNumber, velocity), offset);
+
+            // A note-off the wheel has no room for goes out with its note-on
+            double duration = (tempoMap.tickToSample(note.offTick) - tempoMap.tickToSample(note.tick)) * stretch;
+            if (!noteOffs.add(sendSample + juce::jmax((juce::int64) 1, (juce::int64) duration), channel, note.noteNumber))
+                outputMidi.addEvent(juce::MidiMessage::noteOff(channel, note.noteNumber), offset);
+        }
+
+        return sendSample;
+    }
+
+    // Ends every sounding note at the given offset into the block
+    inline void releaseAll(NoteOffWheel& noteOffs, juce::MidiBuffer& outputMidi, int sampleOffset)
+    {
+        noteOffs.flush([&outputMidi, sampleOffset](int channel, int noteNumber)
+            {
+                outputMidi.addEvent(juce::MidiMessage::noteOff(channel, noteNumber), sampleOffset);
+            });
+    }
+}
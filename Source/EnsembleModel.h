@@ -0,0 +1,717 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "AsynchronyStatistics.h"
+#include "OnsetFifo.h"
+#include "Player.h"
+#include "SchedulingStatistics.h"
+#include "Score.h"
+#include "TempoMap.h"
+
+//==============================================================================
+// ModelRandom - small deterministic generator whose whole position is one 64-bit word,
+// so the noise sequence can be stored in a checkpoint and replayed exactly.
+class ModelRandom
+{
+public:
+    explicit ModelRandom(juce::uint64 seed = 1) : state(seed) {}
+
+    juce::uint64 getState() const { return state; }
+    void setState(juce::uint64 newState) { state = newState; }
+
+    // Uniform in [0, 1)
+    double nextDouble()
+    {
+        // splitmix64
+        juce::uint64 z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        z = z ^ (z >> 31);
+        return (double) (z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Standard normal (Box-Muller, second value discarded to keep the state a single word).
+    // The uniforms are the same in any precision; the transform runs in the one asked for
+    template <typename Scalar = double>
+    Scalar nextGaussian()
+    {
+        auto u1 = (Scalar) (1.0 - nextDouble());
+        auto u2 = (Scalar) nextDouble();
+        return std::sqrt((Scalar) -2 * std::log(u1)) * std::cos((Scalar) 2 * juce::MathConstants<Scalar>::pi * u2);
+    }
+
+private:
+    juce::uint64 state;
+};
+
+//==============================================================================
+// Everything the model needs to continue from a given score onset
+template <typename Scalar>
+struct BasicPlayerState
+{
+    Scalar onset;           // This player's onset at the current score onset, in samples from its nominal time
+    Scalar previousOnset;   // Its onset at the previous score onset, in samples from that one's nominal time
+    Scalar periodOffset;    // Samples per reference beat, less the model's reference period
+    Scalar motorNoise;      // Motor noise applied to the current onset
+    Scalar asynchronySum;   // Accumulated mean asynchrony to the rest of the ensemble
+    Scalar previousAsynchrony;  // Mean asynchrony to the rest of the ensemble at the previous onset
+};
+
+template <typename Scalar>
+struct BasicEnsembleState
+{
+    static constexpr int maxPlayers = 4;
+
+    int onsetIndex = 0;             // Score onset that the player onsets belong to
+    juce::uint64 rngState = 1;      // Position of the noise generator
+    juce::uint32 pendingUsers = 0;  // Bit per user player that has not tapped this onset yet
+    juce::uint32 passedPlayers = 0; // Bit per computer player whose onset the clock has passed
+    std::array<BasicPlayerState<Scalar>, maxPlayers> players {};
+};
+
+using PlayerState = BasicPlayerState<double>;
+using EnsembleState = BasicEnsembleState<double>;
+
+//==============================================================================
+// BasicEnsembleModel - linear phase and period correction between the players, stepped once
+// per score onset. Onset times are in host samples.
+//
+// Scalar is the type of the players' state and of the step's arithmetic. Times going in and
+// out (relocation, taps, send times) stay double either way, as do the nominal onset times and
+// the noise generator, so both precisions draw the same noise. EnsembleModel (double) is the
+// reference the plugin plays; FloatEnsembleModel is for batch simulation where
+// ModelPrecision::runCheck shows its error is small enough for the score. The offline renderer
+// selects it with --float.
+//
+// The players' onsets are held relative to the nominal times of their score onsets and their
+// periods relative to the reference period, so the state stays small and its rounding does not
+// grow with the position in the score. getOnset() and getPeriod() give host samples.
+//
+// Every checkpointInterval onsets the state is stored, first from a simulated run over the
+// whole score (users taken as perfect timekeepers) and then overwritten with the real state
+// as the performance passes. Relocating the transport restores the nearest checkpoint and
+// replays at most checkpointInterval - 1 onsets, so it always fits inside one block.
+//
+// With predictive scheduling the model does not wait for a late user past the point where a
+// computer player's next onset is about to be due. It steps on the user's predicted onset - a
+// timekeeper at their period, less their own phase correction to the ensemble as estimated from
+// their taps so far - and when the tap does arrive, the step is corrected as far as it still
+// can be: computer onsets not yet sent move by up to maxLateCorrectionMs.
+//
+// Built on the message thread; everything after construction is allocation free.
+template <typename Scalar>
+class BasicEnsembleModel
+{
+public:
+    using State = BasicEnsembleState<Scalar>;
+    using PlayerState = BasicPlayerState<Scalar>;
+
+    static constexpr int maxPlayers = State::maxPlayers;
+    static constexpr int checkpointInterval = 16;
+
+    BasicEnsembleModel(const CompiledScore& compiledScore, const TempoMap& preparedTempoMap,
+                       const juce::Array<Player>& playerArray, juce::uint64 seed = 1)
+        : score(compiledScore), sampleRate(preparedTempoMap.getSampleRate())
+    {
+        jassert(sampleRate > 0.0 && score.getNumOnsets() > 0);
+
+        numPlayers = juce::jmin(playerArray.size(), maxPlayers);
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            const auto& player = players[(size_t) i] = playerArray[i];
+            delaySamples[(size_t) i] = msToSamples(player.getDelay());
+            if (player.getIsUser())
+                userMask |= 1u << i;
+
+            // The step's coefficients, converted once
+            for (int j = 0; j < maxPlayers; ++j)
+            {
+                alphas[(size_t) i][(size_t) j] = (Scalar) player.getAlphas()[(size_t) j];
+                betas[(size_t) i][(size_t) j] = (Scalar) player.getBetas()[(size_t) j];
+            }
+            motorNoiseSamples[(size_t) i] = (Scalar) msToSamples(player.getMotorNoiseSTD());
+            timeKeeperNoiseSamples[(size_t) i] = (Scalar) msToSamples(player.getTimeKeeperNoiseSTD());
+        }
+
+        // Nominal onset times double as the index from host position to score onset
+        TempoMap::Cursor cursor(preparedTempoMap);
+        onsetSamples.reserve(score.onsets.size());
+        for (const auto& onset : score.onsets)
+            onsetSamples.push_back(cursor.tickToSample(onset.tick));
+
+        // Which players have notes at each onset - users are only waited for when they have something to play
+        onsetPlayers.reserve(score.onsets.size());
+        for (int onset = 0; onset < score.getNumOnsets(); ++onset)
+        {
+            juce::uint32 mask = 0;
+            for (int i = 0; i < numPlayers; ++i)
+                if (score.hasChannel(onset, players[(size_t) i].getMidiChannel()))
+                    mask |= 1u << i;
+            onsetPlayers.push_back(mask);
+        }
+
+        referencePeriod = preparedTempoMap.getSecondsPerQuarterNoteAt(score.onsets.front().tick) * sampleRate;
+        tapDebounce = score.chordToleranceMs * 0.001 * sampleRate;
+        lastTapTimes.fill(-tapDebounce - 1.0);
+
+        // Seed the checkpoint table with a simulated run over the whole score
+        checkpoints.resize((size_t) (score.getNumOnsets() + checkpointInterval - 1) / checkpointInterval);
+        resetToStart(seed);
+        while (!isFinished())
+            simulateStep();
+
+        resetToStart(seed);
+        needsRelocation = true;
+    }
+
+    //==============================================================================
+    // Moves the model to the first score onset at or after the host position
+    void relocate(double hostSample)
+    {
+        auto it = std::lower_bound(onsetSamples.begin(), onsetSamples.end(), hostSample);
+        int target = juce::jmin((int) (it - onsetSamples.begin()), getNumOnsets() - 1);
+
+        state = checkpoints[(size_t) (target / checkpointInterval)];
+        while (state.onsetIndex < target)
+            simulateStep();
+
+        // Line the ensemble up with where the host now is in the score
+        auto offset = (Scalar) -getMeanOnset();
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            state.players[(size_t) i].onset += offset;
+            state.players[(size_t) i].previousOnset += offset;
+        }
+
+        state.pendingUsers = getUsersAt(target);
+        state.passedPlayers = 0;
+        lateUsers = 0;
+
+        if (statistics != nullptr)
+            statistics->markDiscontinuity();
+        followsRelocation = true;
+        lastTapTimes.fill(-tapDebounce - 1.0);
+        needsRelocation = false;
+    }
+
+    // Lets the model run up to the given time, stepping onsets once the whole ensemble has played them.
+    // Each computer player with notes at an onset is reported as onComputerOnset(playerIndex, onsetIndex,
+    // sendTime) once the clock passes its send time, which is its onset less the player's delay
+    template <typename OnsetCallback>
+    void advanceTo(double time, OnsetCallback&& onComputerOnset)
+    {
+        for (;;)
+        {
+            for (int i = 0; i < numPlayers; ++i)
+            {
+                juce::uint32 bit = 1u << i;
+                if ((userMask & bit) != 0 || (state.passedPlayers & bit) != 0)
+                    continue;
+
+                double sendTime = getOnset(i) - delaySamples[(size_t) i];
+                if (sendTime >= time)
+                    continue;
+
+                state.passedPlayers |= bit;
+                if ((onsetPlayers[(size_t) state.onsetIndex] & bit) != 0)
+                    onComputerOnset(i, state.onsetIndex, sendTime);
+            }
+
+            if (isFinished() || (state.passedPlayers | userMask) != getAllPlayersMask())
+                return;
+
+            if (state.pendingUsers != 0 && !(predictive && time >= getPredictionDeadline()))
+                return;
+
+            // Taps still owed for the onset before this one are not coming now
+            if (lateUsers != 0)
+                finishLateOnset();
+
+            if (state.pendingUsers != 0)
+            {
+                // The onset is recorded once its late taps are in
+                provisional = state;
+                lateUsers = state.pendingUsers;
+                state.pendingUsers = 0;
+                if (schedulingStatistics != nullptr)
+                    schedulingStatistics->addPredictiveStep();
+            }
+            else if (statistics != nullptr || onsetFifo != nullptr)
+            {
+                recordOnset(state);
+            }
+
+            step();
+        }
+    }
+
+    void advanceTo(double time)
+    {
+        advanceTo(time, [](int, int, double) {});
+    }
+
+    // A user tap on the given MIDI channel. The other notes of a chord (within the score's chord
+    // tolerance) and taps before the rest of the ensemble has reached the next onset are ignored.
+    // Returns the score onset the tap was taken for, or -1
+    int addUserOnset(int midiChannel, double time)
+    {
+        int takenFor = -1;
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            juce::uint32 bit = 1u << i;
+            if ((userMask & bit) == 0 || players[(size_t) i].getMidiChannel() != midiChannel)
+                continue;
+
+            bool isChordNote = time - lastTapTimes[(size_t) i] <= tapDebounce;
+            lastTapTimes[(size_t) i] = time;
+            if (isChordNote)
+                continue;
+
+            // Owed for the onset already stepped past, unless it is nearer this player's next one
+            if ((lateUsers & bit) != 0)
+            {
+                double provisionalOnset = onsetSamples[(size_t) provisional.onsetIndex] + (double) provisional.players[(size_t) i].onset;
+                if (std::abs(time - provisionalOnset) < std::abs(time - getOnset(i)))
+                {
+                    takenFor = provisional.onsetIndex;
+                    applyLateUserOnset(i, time);
+                    continue;
+                }
+
+                lateUsers &= ~bit;
+                if (lateUsers == 0)
+                    finishLateOnset();
+            }
+
+            if ((state.pendingUsers & bit) == 0)
+                continue;
+
+            takenFor = state.onsetIndex;
+            applyUserOnset(i, time);
+        }
+        return takenFor;
+    }
+
+    // A user player's onset that arrived from elsewhere (another instance on the network), already
+    // on the host's sample clock. Only taken for the score onset the model is waiting on, or the
+    // one before when that was stepped past on a prediction
+    bool addRemoteOnset(int playerIndex, int onsetIndex, double time)
+    {
+        if (onsetIndex == state.onsetIndex - 1 && (lateUsers & (1u << playerIndex)) != 0)
+        {
+            applyLateUserOnset(playerIndex, time);
+            return true;
+        }
+
+        if (onsetIndex != state.onsetIndex || !isWaitingFor(playerIndex))
+            return false;
+
+        applyUserOnset(playerIndex, time);
+        return true;
+    }
+
+    // Stops waiting for a user player at the current onset; its predicted onset stands in
+    void skipUserOnset(int playerIndex) { state.pendingUsers &= ~(1u << playerIndex); }
+
+    bool isWaitingFor(int playerIndex) const { return (state.pendingUsers & (1u << playerIndex)) != 0; }
+
+    // First player on the given MIDI channel, or -1
+    int findPlayer(int midiChannel) const
+    {
+        for (int i = 0; i < numPlayers; ++i)
+            if (players[(size_t) i].getMidiChannel() == midiChannel)
+                return i;
+        return -1;
+    }
+
+    // Live performance onsets are added to these statistics; relocation replays are not
+    void setStatistics(AsynchronyStatistics* newStatistics) { statistics = newStatistics; }
+
+    // Live performance onsets are also pushed here for the editor's monitor
+    void setOnsetFifo(OnsetFifo* newOnsetFifo) { onsetFifo = newOnsetFifo; }
+
+    // Prediction errors and late corrections go here
+    void setSchedulingStatistics(SchedulingStatistics* newStatistics) { schedulingStatistics = newStatistics; }
+
+    // Off (reactive) in a new model, so every step waits for all of the users' taps. The
+    // processor turns it on for its models unless setPredictiveScheduling(false) was called
+    void setPredictive(bool shouldPredict) { predictive = shouldPredict; }
+    bool isPredictive() const { return predictive; }
+
+    //==============================================================================
+    bool isFinished() const { return state.onsetIndex >= getNumOnsets() - 1; }
+    bool getNeedsRelocation() const { return needsRelocation; }
+    int getNumOnsets() const { return score.getNumOnsets(); }
+    int getNumPlayers() const { return numPlayers; }
+    double getReferencePeriod() const { return referencePeriod; }
+    double getSampleRate() const { return sampleRate; }
+    const State& getState() const { return state; }
+
+    // A player's onset at the current score onset, in host samples
+    double getOnset(int playerIndex) const
+    {
+        return onsetSamples[(size_t) state.onsetIndex] + (double) state.players[(size_t) playerIndex].onset;
+    }
+
+    // A player's current period, in samples per reference beat
+    double getPeriod(int playerIndex) const
+    {
+        return referencePeriod + (double) state.players[(size_t) playerIndex].periodOffset;
+    }
+    const Player& getPlayer(int index) const { return players[(size_t) index]; }
+
+private:
+    void resetToStart(juce::uint64 seed)
+    {
+        state = {};
+        state.rngState = seed;
+        state.pendingUsers = getUsersAt(0);
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            auto& player = state.players[(size_t) i];
+            player.onset = 0;
+            player.previousOnset = 0;
+            player.periodOffset = 0;
+        }
+
+        checkpoints.front() = state;
+    }
+
+    void applyUserOnset(int playerIndex, double time)
+    {
+        auto& player = state.players[(size_t) playerIndex];
+        auto onset = (Scalar) (time - onsetSamples[(size_t) state.onsetIndex]);
+        Scalar beats = getInterval(state.onsetIndex - 1);
+        notePrediction(playerIndex, player, beats, onset);
+
+        if (beats > 0)
+            player.periodOffset += userPeriodSmoothing * ((onset - player.previousOnset) / beats - player.periodOffset);
+
+        player.onset = onset;
+        state.pendingUsers &= ~(1u << playerIndex);
+    }
+
+    // A tap for the onset before the current one, which was stepped past on this user's prediction.
+    // Redoes what the step can still change: the user's own period and next onset, every period,
+    // and the onsets of computer players that have not been sent yet, moved by at most
+    // maxLateCorrectionMs. Onsets already sent stay where they were
+    void applyLateUserOnset(int playerIndex, double time)
+    {
+        auto& predicted = provisional.players[(size_t) playerIndex];
+        auto onset = (Scalar) (time - onsetSamples[(size_t) provisional.onsetIndex]);
+        Scalar previousBeats = getInterval(provisional.onsetIndex - 1);
+        Scalar error = onset - predicted.onset;
+        notePrediction(playerIndex, predicted, previousBeats, onset);
+
+        Scalar periodOffset = predicted.periodOffset;
+        if (previousBeats > 0)
+            periodOffset += userPeriodSmoothing * ((onset - predicted.previousOnset) / previousBeats - periodOffset);
+        predicted.onset = onset;
+
+        Scalar beats = getInterval(provisional.onsetIndex);
+        Scalar share = numPlayers > 1 ? error / (Scalar) (numPlayers - 1) : (Scalar) 0;
+        auto maxShift = (Scalar) msToSamples(maxLateCorrectionMs);
+        int numClamped = 0, numMissed = 0;
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            auto& player = state.players[(size_t) i];
+            if (i == playerIndex)
+            {
+                player.previousOnset = onset;
+                player.periodOffset = periodOffset;
+                player.previousAsynchrony += error;
+                player.asynchronySum += error;
+                player.onset = getUserPlaceholder(i, onset, periodOffset, beats, player.previousAsynchrony);
+                continue;
+            }
+
+            player.previousAsynchrony -= share;
+            player.asynchronySum -= share;
+
+            if (players[(size_t) i].getIsUser())
+            {
+                if (predictive)
+                    player.onset += userCorrections[(size_t) i] * share;
+                continue;
+            }
+
+            // The asynchrony to this user changed by -error, so the corrections change with it
+            player.periodOffset += betas[(size_t) i][(size_t) playerIndex] * error;
+            Scalar shift = alphas[(size_t) i][(size_t) playerIndex] * error;
+            juce::uint32 bit = 1u << i;
+            if ((state.passedPlayers & bit) != 0)
+            {
+                if (shift != 0 && (onsetPlayers[(size_t) state.onsetIndex] & bit) != 0)
+                    ++numMissed;
+                continue;
+            }
+
+            Scalar boundedShift = juce::jlimit(-maxShift, maxShift, shift);
+            if (boundedShift != shift)
+                ++numClamped;
+            player.onset += boundedShift;
+        }
+
+        if (schedulingStatistics != nullptr)
+            schedulingStatistics->addLateCorrection(numClamped, numMissed);
+
+        lateUsers &= ~(1u << playerIndex);
+        if (lateUsers == 0)
+            finishLateOnset();
+    }
+
+    // Records the onset stepped past on predictions, with whichever late taps arrived
+    void finishLateOnset()
+    {
+        if (statistics != nullptr || onsetFifo != nullptr)
+            recordOnset(provisional);
+        lateUsers = 0;
+    }
+
+    // Scores a user's tap against the onset predicted for it, and refines the estimate of how
+    // strongly the user corrects towards the ensemble: the part of the tap their timekeeping does
+    // not explain, regressed on their asynchrony at the onset before. The tap is relative to the predicted onset's nominal time
+    void notePrediction(int playerIndex, const PlayerState& predicted, Scalar beats, Scalar onset)
+    {
+        if (schedulingStatistics != nullptr)
+            schedulingStatistics->addPredictionError((double) (onset - predicted.onset) * 1000.0 / sampleRate);
+
+        if (beats <= 0)
+            return;
+
+        Scalar x = predicted.previousAsynchrony;
+        Scalar y = predicted.previousOnset + predicted.periodOffset * beats - onset;
+        auto& sumXY = correctionSumXY[(size_t) playerIndex];
+        auto& sumXX = correctionSumXX[(size_t) playerIndex];
+        sumXY = correctionForgetting * sumXY + x * y;
+        sumXX = correctionForgetting * sumXX + x * x;
+
+        // The prior keeps the estimate near zero until the asynchronies are large enough to tell
+        auto prior = (Scalar) (msToSamples(correctionPriorMs) * msToSamples(correctionPriorMs));
+        userCorrections[(size_t) playerIndex] = juce::jlimit((Scalar) 0, (Scalar) 1, sumXY / (sumXX + prior));
+    }
+
+    // A user's next onset until their tap arrives: a timekeeper at their period and, when
+    // predicting, the phase correction they have been seen to make. A nominal interval needs no
+    // term of its own: the onsets are relative to their score onsets' nominal times
+    Scalar getUserPlaceholder(int playerIndex, Scalar onset, Scalar periodOffset, Scalar beats, Scalar meanAsynchrony) const
+    {
+        Scalar placeholder = onset + periodOffset * beats;
+        if (predictive)
+            placeholder -= userCorrections[(size_t) playerIndex] * meanAsynchrony;
+        return placeholder;
+    }
+
+    // The latest time the model can wait for the users before a computer player's next onset
+    // would be computed too late to send on time
+    double getPredictionDeadline() const
+    {
+        Scalar beats = getInterval(state.onsetIndex);
+        double deadline = std::numeric_limits<double>::max();
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            juce::uint32 bit = 1u << i;
+            if ((userMask & bit) != 0 || (onsetPlayers[(size_t) state.onsetIndex + 1] & bit) == 0)
+                continue;
+
+            const auto& player = state.players[(size_t) i];
+            deadline = juce::jmin(deadline, (double) (player.onset + player.periodOffset * beats) - delaySamples[(size_t) i]);
+        }
+
+        deadline += onsetSamples[(size_t) state.onsetIndex + 1];
+
+        return deadline - msToSamples(predictionLeadMs);
+    }
+
+    // Reference beats between score onset index and index + 1
+    Scalar getInterval(int index) const
+    {
+        if (index < 0 || index + 1 >= getNumOnsets())
+            return 0;
+        return (Scalar) ((onsetSamples[(size_t) index + 1] - onsetSamples[(size_t) index]) / referencePeriod);
+    }
+
+    // Relative to the current score onset's nominal time, as the players' onsets are
+    double getMeanOnset() const
+    {
+        double sum = 0.0;
+        for (int i = 0; i < numPlayers; ++i)
+            sum += (double) state.players[(size_t) i].onset;
+        return numPlayers > 0 ? sum / numPlayers : 0.0;
+    }
+
+    juce::uint32 getAllPlayersMask() const { return (1u << numPlayers) - 1; }
+    juce::uint32 getUsersAt(int onsetIndex) const { return userMask & onsetPlayers[(size_t) onsetIndex]; }
+
+    // Steps without waiting for the users. Their placeholder onsets already assume a
+    // perfect timekeeper at their current period
+    void simulateStep()
+    {
+        state.pendingUsers = 0;
+        step();
+    }
+
+    // Computes every player's next onset from the asynchronies at the current one
+    void step()
+    {
+        Scalar beats = getInterval(state.onsetIndex);
+        ModelRandom random(state.rngState);
+        std::array<PlayerState, maxPlayers> next = state.players;
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            const auto& current = state.players[(size_t) i];
+            Scalar phaseCorrection = 0, periodCorrection = 0, asynchronyTotal = 0;
+
+            for (int j = 0; j < numPlayers; ++j)
+            {
+                if (j == i)
+                    continue;
+
+                Scalar asynchrony = current.onset - state.players[(size_t) j].onset;
+                phaseCorrection += alphas[(size_t) i][(size_t) j] * asynchrony;
+                periodCorrection += betas[(size_t) i][(size_t) j] * asynchrony;
+                asynchronyTotal += asynchrony;
+            }
+
+            auto& updated = next[(size_t) i];
+            Scalar meanAsynchrony = numPlayers > 1 ? asynchronyTotal / (Scalar) (numPlayers - 1) : (Scalar) 0;
+            updated.previousOnset = current.onset;
+            updated.previousAsynchrony = meanAsynchrony;
+            updated.asynchronySum += meanAsynchrony;
+
+            if ((userMask & (1u << i)) != 0)
+            {
+                updated.onset = getUserPlaceholder(i, current.onset, current.periodOffset, beats, meanAsynchrony);
+                continue;
+            }
+
+            Scalar motorNoise = random.template nextGaussian<Scalar>() * motorNoiseSamples[(size_t) i];
+            Scalar timeKeeperNoise = random.template nextGaussian<Scalar>() * timeKeeperNoiseSamples[(size_t) i];
+
+            // The reference period's share of the interval is the move to the next nominal time
+            updated.onset = current.onset + current.periodOffset * beats - phaseCorrection
+                            + timeKeeperNoise + motorNoise - current.motorNoise;
+            updated.periodOffset = current.periodOffset - periodCorrection;
+            updated.motorNoise = motorNoise;
+        }
+
+        state.players = next;
+        state.rngState = random.getState();
+        state.pendingUsers = getUsersAt(state.onsetIndex + 1);
+        state.passedPlayers = 0;
+        ++state.onsetIndex;
+
+        if (state.onsetIndex % checkpointInterval == 0)
+            checkpoints[(size_t) (state.onsetIndex / checkpointInterval)] = state;
+    }
+
+    void recordOnset(const State& recorded)
+    {
+        juce::uint32 playedMask = onsetPlayers[(size_t) recorded.onsetIndex];
+        std::array<double, maxPlayers> onsetsMs {};
+        double base = onsetSamples[(size_t) recorded.onsetIndex];
+        for (int i = 0; i < numPlayers; ++i)
+            onsetsMs[(size_t) i] = (base + (double) recorded.players[(size_t) i].onset) * 1000.0 / sampleRate;
+
+        if (statistics != nullptr)
+            statistics->addOnset(onsetsMs.data(), numPlayers, playedMask);
+
+        if (onsetFifo == nullptr)
+            return;
+
+        OnsetRecord record;
+        record.onsetIndex = recorded.onsetIndex;
+        record.numPlayers = numPlayers;
+        record.playedMask = playedMask;
+        record.followsRelocation = followsRelocation;
+        followsRelocation = false;
+
+        double meanMs = 0.0;
+        int numPlayed = 0;
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            if ((playedMask & (1u << i)) != 0)
+            {
+                meanMs += onsetsMs[(size_t) i];
+                ++numPlayed;
+            }
+        }
+        if (numPlayed > 0)
+            meanMs /= numPlayed;
+
+        // The same pairwise terms step() is about to apply; user players are not corrected
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            if ((playedMask & (1u << i)) != 0)
+                record.asynchronyMs[(size_t) i] = (float) (onsetsMs[(size_t) i] - meanMs);
+
+            if (players[(size_t) i].getIsUser())
+                continue;
+
+            for (int j = 0; j < numPlayers; ++j)
+            {
+                if (j == i)
+                    continue;
+
+                double asynchronyMs = onsetsMs[(size_t) i] - onsetsMs[(size_t) j];
+                record.phaseCorrectionMs[(size_t) i][(size_t) j] = (float) (players[(size_t) i].getAlphas()[(size_t) j] * asynchronyMs);
+                record.periodCorrectionMs[(size_t) i][(size_t) j] = (float) (players[(size_t) i].getBetas()[(size_t) j] * asynchronyMs);
+            }
+        }
+
+        onsetFifo->push(record);
+    }
+
+    double msToSamples(double ms) const { return ms * 0.001 * sampleRate; }
+
+    static constexpr Scalar userPeriodSmoothing = (Scalar) 0.5;
+    static constexpr double predictionLeadMs = 10.0;        // Margin before the deadline, for the step's own corrections
+    static constexpr double maxLateCorrectionMs = 30.0;
+    static constexpr Scalar correctionForgetting = (Scalar) 0.95;  // Per tap, for the users' estimated phase correction
+    static constexpr double correctionPriorMs = 5.0;
+
+    const CompiledScore& score;
+    double sampleRate;
+    double referencePeriod = 0.0;   // Samples per beat at the score's opening tempo
+
+    std::array<Player, maxPlayers> players;
+    std::array<double, maxPlayers> delaySamples {};  // Output latency of each computer player
+    std::array<std::array<Scalar, maxPlayers>, maxPlayers> alphas {}, betas {};
+    std::array<Scalar, maxPlayers> motorNoiseSamples {}, timeKeeperNoiseSamples {};   // Noise STDs in samples
+    int numPlayers = 0;
+    juce::uint32 userMask = 0;
+
+    std::vector<double> onsetSamples;           // Nominal sample time of each score onset
+    std::vector<juce::uint32> onsetPlayers;     // Bit per player with notes at each score onset
+    std::vector<State> checkpoints;             // State at every checkpointInterval-th onset
+    State state;
+    bool needsRelocation = true;
+
+    AsynchronyStatistics* statistics = nullptr;
+    OnsetFifo* onsetFifo = nullptr;
+    SchedulingStatistics* schedulingStatistics = nullptr;
+    bool followsRelocation = false;             // The next recorded onset is the first after relocate()
+
+    std::array<double, maxPlayers> lastTapTimes;
+    double tapDebounce = 0.0;                   // Chord tolerance in samples
+
+    // Predictive scheduling
+    bool predictive = false;
+    State provisional;                          // The onset stepped past on predictions, until its late taps are in
+    juce::uint32 lateUsers = 0;                 // Bit per user whose tap for that onset is still owed
+    std::array<Scalar, maxPlayers> userCorrections {};     // Each user's estimated alpha to the ensemble
+    std::array<Scalar, maxPlayers> correctionSumXY {}, correctionSumXX {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BasicEnsembleModel)
+};
+
+using EnsembleModel = BasicEnsembleModel<double>;
+using FloatEnsembleModel = BasicEnsembleModel<float>;
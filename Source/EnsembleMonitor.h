@@ -0,0 +1,286 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "OnsetFifo.h"
+#include "SchedulingStatistics.h"
+#include "TraceLog.h"
+
+//==============================================================================
+// EnsembleMonitor - live view of the performance: a scrolling asynchrony timeline with one
+// lane per player, and heat maps of the phase (alpha) and period (beta) corrections each
+// computer player is applying because of each other player. A line under the timeline sums
+// up the SchedulingStatistics: how far the users' taps were from their predictions and how
+// many computer onsets went out late.
+//
+// A 60 Hz timer drains the processor's OnsetFifo. The timeline is a cached image that is
+// shifted left by one column per onset with only the new column drawn, so the cost per frame
+// does not grow with the length of the session. Nothing is repainted while no onsets arrive.
+class EnsembleMonitor : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int maxPlayers = OnsetRecord::maxPlayers;
+
+    EnsembleMonitor(OnsetFifo& fifo, const SchedulingStatistics& statistics)
+        : onsetFifo(fifo), schedulingStatistics(statistics)
+    {
+        setOpaque(true);
+        smoothedAsynchronyMs.fill(0.0f);
+        startTimerHz(60);
+    }
+
+    ~EnsembleMonitor() override
+    {
+        stopTimer();
+    }
+
+    // Also given every onset taken from the fifo, for other views of the performance
+    std::function<void(const OnsetRecord&)> onOnsetRecord;
+
+    void paint(juce::Graphics& g) override
+    {
+        TraceLog::ScopedTrace trace("ensemble monitor paint", "gui");
+
+        g.fillAll(backgroundColour);
+
+        if (timeline.isValid())
+            g.drawImage(timeline, timelineArea.toFloat());
+
+        if (heatMaps.isValid())
+            g.drawImage(heatMaps, heatMapArea.toFloat());
+
+        g.setColour(juce::Colours::white);
+        g.setFont(juce::FontOptions(20.0f));
+        g.drawText("Asynchrony (early above, late below)", timelineTitleArea, juce::Justification::centredLeft);
+        g.drawText("Phase corrections (ms)", phaseTitleArea, juce::Justification::centredLeft);
+        g.drawText("Period corrections (ms)", periodTitleArea, juce::Justification::centredLeft);
+
+        // Who is leading and lagging, from the smoothed asynchronies
+        g.setFont(juce::FontOptions(15.0f));
+        int laneHeight = laneLabelArea.getHeight() / maxPlayers;
+        for (int i = 0; i < maxPlayers; ++i)
+        {
+            auto lane = juce::Rectangle<int>(laneLabelArea.getX(), laneLabelArea.getY() + i * laneHeight, laneLabelArea.getWidth(), laneHeight);
+            g.setColour(getPlayerColour(i));
+            g.drawText("Player " + juce::String(i + 1), lane.removeFromTop(laneHeight / 2), juce::Justification::bottomLeft);
+
+            if (i < numPlayers)
+            {
+                auto asynchrony = smoothedAsynchronyMs[(size_t) i];
+                g.setColour(juce::Colours::lightgrey);
+                g.drawText(juce::String(asynchrony, 1) + " ms " + (asynchrony < 0.0f ? "leading" : "lagging"), lane, juce::Justification::topLeft);
+            }
+        }
+
+        g.setColour(juce::Colours::lightgrey);
+        g.drawText(schedulingSummary, schedulingArea, juce::Justification::centredLeft);
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced(10);
+        auto right = area.removeFromRight(area.getWidth() / 3);
+        area.removeFromRight(10);
+
+        timelineTitleArea = area.removeFromTop(30);
+        schedulingArea = area.removeFromBottom(24);
+        laneLabelArea = area.removeFromLeft(120);
+        timelineArea = area;
+
+        // Both maps and their titles share one image; the map areas are relative to it
+        int mapHeight = (right.getHeight() - 60) / 2;
+        heatMapArea = right;
+        phaseTitleArea = right.removeFromTop(30);
+        phaseMapArea = right.removeFromTop(mapHeight) - heatMapArea.getPosition();
+        periodTitleArea = right.removeFromTop(30);
+        periodMapArea = right.removeFromTop(mapHeight) - heatMapArea.getPosition();
+
+        // The history is cleared rather than rescaled
+        auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+        imageScale = scale;
+        timeline = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(timelineArea.getWidth() * scale)),
+                               juce::jmax(1, juce::roundToInt(timelineArea.getHeight() * scale)), true);
+        juce::Graphics(timeline).fillAll(backgroundColour.brighter(0.05f));
+        previousY.fill(-1.0f);
+
+        heatMaps = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(heatMapArea.getWidth() * scale)),
+                               juce::jmax(1, juce::roundToInt(heatMapArea.getHeight() * scale)), true);
+        renderHeatMaps();
+    }
+
+private:
+    // Asynchrony that reaches the edge of a lane
+    static constexpr float laneRangeMs = 50.0f;
+    // Correction that gets the strongest heat map colour
+    static constexpr float correctionRangeMs = 10.0f;
+    static constexpr float pixelsPerOnset = 4.0f;
+    static constexpr float smoothing = 0.2f;
+
+    static juce::Colour getPlayerColour(int player)
+    {
+        const juce::Colour colours[] = { juce::Colours::skyblue, juce::Colours::seagreen, juce::Colours::orange, juce::Colours::orchid };
+        return colours[player % maxPlayers];
+    }
+
+    void timerCallback() override
+    {
+        bool hasNewOnsets = false;
+        onsetFifo.popAll([this, &hasNewOnsets](const OnsetRecord& record)
+            {
+                appendOnset(record);
+                hasNewOnsets = true;
+
+                if (onOnsetRecord != nullptr)
+                    onOnsetRecord(record);
+            });
+
+        if (!hasNewOnsets)
+            return;
+
+        TraceLog::ScopedTrace trace("ensemble monitor update", "gui");
+        renderHeatMaps();
+        updateSchedulingSummary();
+        repaint();
+    }
+
+    void updateSchedulingSummary()
+    {
+        auto snapshot = schedulingStatistics.getSnapshot();
+        schedulingSummary = "Taps " + juce::String(snapshot.meanPredictionErrorMs, 1) + " +/- " + juce::String(snapshot.predictionErrorSDMs, 1)
+                            + " ms from prediction, " + juce::String(snapshot.numLateOnsets) + " of " + juce::String(snapshot.numComputerOnsets)
+                            + " onsets late (max " + juce::String(snapshot.maxResponseLatencyMs, 1) + " ms), "
+                            + juce::String(snapshot.numLateCorrections) + " late corrections";
+    }
+
+    // Scrolls the timeline one column left and draws the new onset in the freed column
+    void appendOnset(const OnsetRecord& record)
+    {
+        numPlayers = juce::jmin(record.numPlayers, maxPlayers);
+
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            if ((record.playedMask & (1u << i)) != 0)
+                smoothedAsynchronyMs[(size_t) i] += smoothing * (record.asynchronyMs[(size_t) i] - smoothedAsynchronyMs[(size_t) i]);
+
+            for (int j = 0; j < numPlayers; ++j)
+            {
+                auto& phase = smoothedPhaseMs[(size_t) i][(size_t) j];
+                auto& period = smoothedPeriodMs[(size_t) i][(size_t) j];
+                phase += smoothing * (record.phaseCorrectionMs[(size_t) i][(size_t) j] - phase);
+                period += smoothing * (record.periodCorrectionMs[(size_t) i][(size_t) j] - period);
+            }
+        }
+
+        if (!timeline.isValid())
+            return;
+
+        int width = timeline.getWidth();
+        int height = timeline.getHeight();
+        int shift = juce::jmax(1, juce::roundToInt(pixelsPerOnset * imageScale));
+        timeline.moveImageSection(0, 0, shift, 0, width - shift, height);
+
+        juce::Graphics g(timeline);
+        auto column = juce::Rectangle<int>(width - shift, 0, shift, height);
+        g.setColour(backgroundColour.brighter(0.05f));
+        g.fillRect(column);
+
+        float laneHeight = (float) height / maxPlayers;
+        g.setColour(juce::Colours::grey.withAlpha(0.5f));
+        for (int i = 0; i < maxPlayers; ++i)
+            g.fillRect(column.withY(juce::roundToInt(laneHeight * (i + 0.5f))).withHeight(1));
+
+        if (record.followsRelocation)
+        {
+            g.setColour(juce::Colours::white.withAlpha(0.6f));
+            g.fillRect(column.withWidth(1));
+            previousY.fill(-1.0f);
+        }
+
+        float x = (float) width - shift * 0.5f;
+        float dotSize = 3.0f * imageScale;
+        for (int i = 0; i < numPlayers; ++i)
+        {
+            if ((record.playedMask & (1u << i)) == 0)
+            {
+                previousY[(size_t) i] = -1.0f;
+                continue;
+            }
+
+            auto offset = juce::jlimit(-1.0f, 1.0f, record.asynchronyMs[(size_t) i] / laneRangeMs);
+            float y = laneHeight * (i + 0.5f + 0.45f * offset);
+
+            g.setColour(getPlayerColour(i));
+            if (previousY[(size_t) i] >= 0.0f)
+                g.drawLine(x - (float) shift, previousY[(size_t) i], x, y, imageScale);
+            g.fillEllipse(x - dotSize * 0.5f, y - dotSize * 0.5f, dotSize, dotSize);
+            previousY[(size_t) i] = y;
+        }
+    }
+
+    // Both N x N maps are tiny, so they are redrawn whole whenever onsets arrive
+    void renderHeatMaps()
+    {
+        if (!heatMaps.isValid())
+            return;
+
+        juce::Graphics g(heatMaps);
+        g.addTransform(juce::AffineTransform::scale(imageScale));
+        g.fillAll(backgroundColour);
+        g.setFont(juce::FontOptions(14.0f));
+
+        drawHeatMap(g, phaseMapArea, smoothedPhaseMs);
+        drawHeatMap(g, periodMapArea, smoothedPeriodMs);
+    }
+
+    void drawHeatMap(juce::Graphics& g, juce::Rectangle<int> area,
+                     const std::array<std::array<float, maxPlayers>, maxPlayers>& correctionsMs) const
+    {
+        int cellWidth = area.getWidth() / maxPlayers;
+        int cellHeight = area.getHeight() / maxPlayers;
+
+        for (int i = 0; i < maxPlayers; ++i)
+        {
+            for (int j = 0; j < maxPlayers; ++j)
+            {
+                auto cell = juce::Rectangle<int>(area.getX() + j * cellWidth, area.getY() + i * cellHeight, cellWidth, cellHeight).reduced(1);
+                if (i >= numPlayers || j >= numPlayers || i == j)
+                {
+                    g.setColour(backgroundColour.brighter(0.05f));
+                    g.fillRect(cell);
+                    continue;
+                }
+
+                // Red pulls the player earlier, blue later
+                auto correction = correctionsMs[(size_t) i][(size_t) j];
+                auto strength = juce::jmin(1.0f, std::abs(correction) / correctionRangeMs);
+                g.setColour(backgroundColour.brighter(0.15f).interpolatedWith(correction > 0.0f ? juce::Colours::red : juce::Colours::dodgerblue, strength));
+                g.fillRect(cell);
+
+                g.setColour(juce::Colours::white);
+                g.drawText(juce::String(correction, 1), cell, juce::Justification::centred);
+            }
+        }
+    }
+
+    OnsetFifo& onsetFifo;
+    const SchedulingStatistics& schedulingStatistics;
+    juce::String schedulingSummary;     // Updated with the onsets
+    const juce::Colour backgroundColour = juce::Colours::black.brighter(0.12f);
+
+    // Layout, worked out in resized()
+    juce::Rectangle<int> timelineTitleArea, laneLabelArea, timelineArea, schedulingArea;
+    juce::Rectangle<int> phaseTitleArea, periodTitleArea, heatMapArea;
+    juce::Rectangle<int> phaseMapArea, periodMapArea;
+
+    juce::Image timeline;           // Scrolls left one column per onset
+    juce::Image heatMaps;           // Both maps, redrawn whenever onsets arrive
+    float imageScale = 1.0f;
+    std::array<float, maxPlayers> previousY {};     // Last point of each lane in timeline pixels, -1 for none
+
+    int numPlayers = 0;
+    std::array<float, maxPlayers> smoothedAsynchronyMs {};
+    std::array<std::array<float, maxPlayers>, maxPlayers> smoothedPhaseMs {};
+    std::array<std::array<float, maxPlayers>, maxPlayers> smoothedPeriodMs {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EnsembleMonitor)
+};
@@ -0,0 +1,247 @@
+#include "EnsembleWorkers.h"
+#include "GroupEnsemble.h"
+#include "PluginProcessor.h"
+#include "RealtimeCheck.h"
+#include "TraceLog.h"
+#include <vector>
+
+EnsembleWorkers::EnsembleWorkers() = default;
+
+EnsembleWorkers::~EnsembleWorkers()
+{
+    stop();
+}
+
+// Real-time threads where the system allows them, otherwise the highest normal priority
+void EnsembleWorkers::start(int numThreads, double sampleRate, int blockSize)
+{
+    stop();
+
+    for (int i = 0; i < juce::jlimit(0, maxThreads, numThreads); ++i)
+    {
+        auto* worker = workers.add(new Worker(*this, i));
+        auto options = juce::Thread::RealtimeOptions().withApproximateAudioProcessingTime(juce::jmax(1, blockSize), sampleRate);
+        if (!worker->startRealtimeThread(options))
+            worker->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+void EnsembleWorkers::stop()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread(1000);
+
+    workers.clear();
+}
+
+void EnsembleWorkers::finish()
+{
+    runJobs();
+
+    // Only jobs a worker has already started are left, so this is never long
+    while (numJobsDone.load(std::memory_order_acquire) < numBlockJobs)
+    {
+    }
+}
+
+// A ticket taken after the block's jobs have all gone has an index past the count, so a worker
+// still looking for work from the last block never takes or skips one of the next
+void EnsembleWorkers::runJobs()
+{
+    for (;;)
+    {
+        auto ticket = tickets.fetch_add(1, std::memory_order_acq_rel);
+        auto index = (int) (ticket & 0xffffffffu);
+        if (index >= (int) (ticket >> 32))
+            return;
+
+        jobFunction(jobContext, index);
+        numJobsDone.fetch_add(1, std::memory_order_release);
+    }
+}
+
+//==============================================================================
+#pragma region Worker Threads
+
+EnsembleWorkers::Worker::Worker(EnsembleWorkers& owner, int index)
+    : juce::Thread("Ensemble Worker " + juce::String(index + 1)), pool(owner)
+{
+}
+
+void EnsembleWorkers::Worker::run()
+{
+    TraceLog::setThreadName("Ensemble Worker");
+    auto spinTicks = juce::Time::getHighResolutionTicksPerSecond() * spinMicroseconds / 1000000;
+    auto seen = pool.generation.load(std::memory_order_acquire);
+
+    while (!threadShouldExit())
+    {
+        // Spins first, as the next block is often only a little way off
+        auto spinEnd = juce::Time::getHighResolutionTicks() + spinTicks;
+        while (pool.generation.load(std::memory_order_relaxed) == seen && juce::Time::getHighResolutionTicks() < spinEnd)
+        {
+        }
+
+        if (pool.generation.load(std::memory_order_acquire) == seen)
+        {
+            // begin() bumps the generation before looking at this flag, so either it sees the
+            // flag and signals or this sees the new generation and does not wait
+            sleeping.store(true, std::memory_order_seq_cst);
+            if (pool.generation.load(std::memory_order_seq_cst) == seen && !threadShouldExit())
+                wakeUp.wait(100);
+
+            sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        seen = pool.generation.load(std::memory_order_acquire);
+
+        RealtimeCheck::ScopedAudioThread audioThread("ensembleWorker");
+        pool.runJobs();
+    }
+}
+
+#pragma endregion Worker Threads
+//==============================================================================
+#pragma region Scaling Benchmark
+
+namespace
+{
+    struct BenchmarkPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override { return info; }
+        PositionInfo info;
+    };
+
+    struct BenchmarkRun
+    {
+        std::vector<juce::uint8> midi;      // Every output event's time and bytes, to compare runs
+        double meanBlockUs = 0.0;
+        double maxBlockUs = 0.0;
+    };
+
+    // The main ensemble and numEnsembles - 1 group ensembles of the same players, each on the nearest free channels
+    BenchmarkRun play(const juce::File& midiFile, const juce::Array<Player>& players, int numEnsembles,
+                      int numThreads, double sampleRate, int blockSize, juce::int64 endSample)
+    {
+        AdaptiveMetronomeAudioProcessor processor;
+        processor.UpdatePlayers(players);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.loadScore(midiFile);
+        for (int i = 1; i < numEnsembles; ++i)
+        {
+            int index = processor.addGroupEnsemble(players, processor.findFreeChannelOffset(players));
+            jassert(index >= 0);    // Single-channel ensembles, so all 16 fit
+            juce::ignoreUnused(index);
+        }
+        processor.setNumEnsembleThreads(numThreads);
+
+        BenchmarkPlayHead playHead;
+        playHead.info.setIsPlaying(true);
+        processor.setPlayHead(&playHead);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(65536);
+
+        BenchmarkRun run;
+        int numBlocks = 0;
+        for (juce::int64 position = 0; position < endSample; position += blockSize)
+        {
+            buffer.clear();
+            midi.clear();
+            playHead.info.setTimeInSamples(position);
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            auto blockUs = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+            run.meanBlockUs += blockUs;
+            run.maxBlockUs = juce::jmax(run.maxBlockUs, blockUs);
+            ++numBlocks;
+
+            for (const auto metadata : midi)
+            {
+                auto time = position + metadata.samplePosition;
+                for (int byte = 0; byte < 8; ++byte)
+                    run.midi.push_back((juce::uint8) (time >> (8 * byte)));
+
+                auto message = metadata.getMessage();
+                run.midi.insert(run.midi.end(), message.getRawData(), message.getRawData() + message.getRawDataSize());
+            }
+        }
+
+        processor.setPlayHead(nullptr);
+        run.meanBlockUs /= juce::jmax(1, numBlocks);
+        return run;
+    }
+}
+
+bool EnsembleWorkers::runScalingBenchmark(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double maxSeconds = 30.0;
+    report.clear();
+
+    if (players.size() == 0)
+    {
+        report = "No players";
+        return false;
+    }
+
+    // Each ensemble is the first player alone, on a channel of its own, so 16 fit on the
+    // processor's channels. It is a computer player, so the runs play the same without anyone tapping
+    auto benchmarkPlayer = players.getReference(0);
+    benchmarkPlayer.setIsUser(false);
+    juce::Array<Player> ensemblePlayers;
+    ensemblePlayers.add(benchmarkPlayer);
+
+    // Held for the whole benchmark, so every run shares one compiled score
+    juce::SharedResourcePointer<ScoreCache> scoreCache;
+    auto score = scoreCache->acquire(midiFile, ScoreCompiler::defaultChordToleranceMs);
+    if (score == nullptr || score->getNumOnsets() == 0)
+    {
+        scoreCache->release(score);
+        report = "Could not load " + midiFile.getFileName();
+        return false;
+    }
+
+    TempoMap tempoMap = score->tempoMap;
+    tempoMap.prepare(sampleRate);
+    auto endSample = (juce::int64) juce::jmin(maxSeconds * sampleRate, tempoMap.tickToSample(score->onsets.back().tick) + sampleRate);
+    int availableThreads = juce::jmax(0, juce::SystemStats::getNumCpus() - 1);     // As the processor allows
+
+    bool passed = true;
+    for (int blockSize : { 512, 32 })
+    {
+        auto blockUs = blockSize * 1.0e6 / sampleRate;
+        report << "Block size " << blockSize << " (" << juce::String(blockUs, 0) << " us)"
+               << (blockSize < minSamplesToSplit ? ", processed serially:\n" : ":\n");
+
+        for (int numEnsembles : { 1, 2, 4, 8, 16 })
+        {
+            int numThreads = juce::jmin(numEnsembles - 1, maxThreads, availableThreads);
+            auto serial = play(midiFile, ensemblePlayers, numEnsembles, 0, sampleRate, blockSize, endSample);
+            auto parallel = play(midiFile, ensemblePlayers, numEnsembles, numThreads, sampleRate, blockSize, endSample);
+
+            bool samePassed = !serial.midi.empty() && serial.midi == parallel.midi;
+            passed = passed && samePassed;
+
+            report << "  " << numEnsembles << " ensembles, " << numThreads << " workers: serial "
+                   << juce::String(serial.meanBlockUs, 1) << " us mean " << juce::String(serial.maxBlockUs, 1) << " us max, parallel "
+                   << juce::String(parallel.meanBlockUs, 1) << " us mean " << juce::String(parallel.maxBlockUs, 1) << " us max, speedup "
+                   << juce::String(serial.meanBlockUs / juce::jmax(1.0e-3, parallel.meanBlockUs), 2)
+                   << (samePassed ? "" : " OUTPUT DIFFERS") << "\n";
+        }
+    }
+
+    scoreCache->release(score);
+    return passed;
+}
+
+#pragma endregion Scaling Benchmark
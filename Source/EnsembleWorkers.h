@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "Player.h"
+
+//==============================================================================
+// EnsembleWorkers - a few real-time threads that share one block's ensemble jobs with the audio
+// thread.
+//
+// The audio thread publishes the block's jobs with begin(), does its own work, then calls
+// finish(), which takes any jobs the workers have not started and waits for the rest. Jobs are
+// claimed one at a time from an atomic counter, so no job waits for a thread that is busy or
+// was not woken in time, and the join only ever waits for jobs already running.
+//
+// Between blocks a worker spins for a short while, as the next block is often due soon, then
+// sleeps on its event (a futex on Linux). begin() only signals workers that are asleep, so a
+// busy session costs no system calls. Nothing here allocates or locks after start().
+//
+// start() and stop() on the message thread, while the audio thread is not using the workers.
+class EnsembleWorkers
+{
+public:
+    static constexpr int maxThreads = 15;
+    static constexpr int spinMicroseconds = 200;    // Before a worker sleeps
+    static constexpr int minSamplesToSplit = 64;    // Smaller blocks are cheaper to process serially
+
+    EnsembleWorkers();
+    ~EnsembleWorkers();
+
+    void start(int numThreads, double sampleRate, int blockSize);
+    void stop();
+    int getNumThreads() const { return workers.size(); }
+
+    // Whether a block of this many jobs and samples is worth handing out
+    bool shouldSplit(int numJobs, int numSamples) const
+    {
+        return workers.size() > 0 && numJobs > 0 && numSamples >= minSamplesToSplit;
+    }
+
+    // Audio thread. Hands out job(index) for every index below numJobs. The job must stay alive until finish()
+    template <typename Job>
+    void begin(int numJobs, Job& job)
+    {
+        jassert(numJobs >= 0);
+        jobFunction = [](void* context, int index) { (*static_cast<Job*>(context))(index); };
+        jobContext = &job;
+        numBlockJobs = numJobs;
+        numJobsDone.store(0, std::memory_order_relaxed);
+        tickets.store((juce::uint64) numJobs << 32, std::memory_order_release);
+        generation.fetch_add(1, std::memory_order_seq_cst);
+
+        for (auto* worker : workers)
+            if (worker->sleeping.load(std::memory_order_seq_cst))
+                worker->wakeUp.signal();
+    }
+
+    // Audio thread. Runs whatever jobs are left, then waits for the ones the workers took
+    void finish();
+
+    // Runs the loaded score with 1 to 16 ensembles, serially and on the workers, at a large and
+    // a small block size. Reports the processing time per block and checks both give the same MIDI.
+    // Each ensemble needs channels of its own, so each is the first player alone on one channel
+    static bool runScalingBenchmark(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report);
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(EnsembleWorkers& owner, int index);
+        void run() override;
+
+        std::atomic<bool> sleeping { false };
+        juce::WaitableEvent wakeUp;
+
+    private:
+        EnsembleWorkers& pool;
+    };
+
+    void runJobs();
+
+    juce::OwnedArray<Worker> workers;
+
+    void (*jobFunction)(void*, int) = nullptr;
+    void* jobContext = nullptr;
+    int numBlockJobs = 0;                           // Audio thread only
+    std::atomic<juce::uint64> tickets { 0 };        // The block's job count above, the next job to take below
+    std::atomic<int> numJobsDone { 0 };
+    std::atomic<juce::uint32> generation { 0 };     // Bumped for every block handed out
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EnsembleWorkers)
+};
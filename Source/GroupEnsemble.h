@@ -0,0 +1,167 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AsynchronyStatistics.h"
+#include "ComputerNotes.h"
+#include "EnsembleModel.h"
+#include "NoteOffWheel.h"
+#include "Player.h"
+#include "Score.h"
+#include "TempoMap.h"
+#include "TraceLog.h"
+
+//==============================================================================
+// GroupEnsemble - one of the further ensembles a group experiment runs in the same processor
+// instance, next to its main ensemble. Each has its own players, coupling and model and plays the
+// same score on the same transport. Its players pick their parts by MIDI channel as usual, but
+// its taps come in and its notes go out the ensemble's channel offset away from there, so each
+// ensemble of a group has its own channels on the processor's MIDI input and output. The
+// processor only adds an ensemble whose channels are all free (see getChannelMask()).
+//
+// The main ensemble keeps everything tied to the instance (network, OSC, MIDI clock, monitor);
+// a group ensemble is only a model and its notes, so several can be processed at once on
+// EnsembleWorkers. process() touches nothing outside the object except the score, tempo map
+// and input MIDI, which are read-only for the block.
+//
+// Built and given its models on the message thread; process() on the audio thread or a worker.
+class GroupEnsemble
+{
+public:
+    GroupEnsemble(const juce::Array<Player>& ensemblePlayers, int ensembleChannelOffset, juce::uint64 modelSeed)
+        : players(ensemblePlayers), channelOffset(ensembleChannelOffset), seed(modelSeed)
+    {
+    }
+
+    const juce::Array<Player>& getPlayers() const { return players; }
+    int getChannelOffset() const { return channelOffset; }
+    juce::uint32 getChannelMask() const { return getChannelMask(players, channelOffset); }
+
+    // Bit n - 1 for each MIDI channel n the players use once offset, or 0 if any player's
+    // channel is outside 1-16 before or after the offset
+    static juce::uint32 getChannelMask(const juce::Array<Player>& ensemblePlayers, int ensembleChannelOffset)
+    {
+        juce::uint32 mask = 0;
+        for (const auto& player : ensemblePlayers)
+        {
+            int channel = player.getMidiChannel() + ensembleChannelOffset;
+            if (player.getMidiChannel() < 1 || player.getMidiChannel() > 16 || channel < 1 || channel > 16)
+                return 0;
+
+            mask |= 1u << (channel - 1);
+        }
+
+        return mask;
+    }
+    const AsynchronyStatistics& getAsynchronyStatistics() const { return asynchronyStatistics; }
+
+    // Message thread, before the ensemble is handed to the audio thread
+    void prepare(int maxSoundingNotes)
+    {
+        noteOffs.prepare(maxSoundingNotes);
+        outputMidi.ensureSize((size_t) maxSoundingNotes * 8);
+    }
+
+    // Built off the audio thread, then swapped in under the processor's lock. Predictive as the main ensemble's
+    std::unique_ptr<EnsembleModel> createModel(const CompiledScore* compiledScore, const TempoMap& preparedTempoMap, bool predictive)
+    {
+        if (compiledScore == nullptr || compiledScore->getNumOnsets() == 0 || players.size() == 0 || preparedTempoMap.getSampleRate() <= 0.0)
+            return nullptr;
+
+        auto newModel = std::make_unique<EnsembleModel>(*compiledScore, preparedTempoMap, players, seed);
+        newModel->setStatistics(&asynchronyStatistics);
+        newModel->setPredictive(predictive);
+        return newModel;
+    }
+
+    // Called under the processor's lock, with the main ensemble's
+    void setPredictive(bool shouldPredict)
+    {
+        if (model != nullptr)
+            model->setPredictive(shouldPredict);
+    }
+
+    // Called under the processor's lock. The previous model is handed back to be freed outside it
+    void swapModel(std::unique_ptr<EnsembleModel>& newModel)
+    {
+        std::swap(model, newModel);
+        asynchronyStatistics.reset();
+    }
+
+    // Plays one block: relocates with the main ensemble, takes the taps on this ensemble's
+    // channels and advances to the end of the block. The notes are left in getOutput()
+    void process(const CompiledScore& score, const TempoMap& tempoMap, const juce::MidiBuffer& input,
+                 juce::int64 blockStart, int numSamples, bool relocated)
+    {
+        TraceLog::ScopedTrace trace("groupEnsemble", "audio");
+        outputMidi.clear();
+
+        if (model == nullptr)
+            return;
+
+        if (relocated || model->getNeedsRelocation())
+        {
+            releaseAllNotes(0);
+            noteOffs.setPosition(blockStart);
+            model->relocate((double) blockStart);
+        }
+
+        auto sendOnset = [this, &score, &tempoMap, blockStart, numSamples](int playerIndex, int onsetIndex, double sendTime)
+            {
+                sendComputerOnset(score, tempoMap, playerIndex, onsetIndex, sendTime, blockStart, numSamples);
+            };
+
+        for (const auto metadata : input)
+        {
+            auto message = metadata.getMessage();
+            int scoreChannel = message.getChannel() - channelOffset;
+            if (!message.isNoteOn() || model->findPlayer(scoreChannel) < 0)
+                continue;
+
+            double tapTime = (double) (blockStart + metadata.samplePosition);
+            model->advanceTo(tapTime, sendOnset);
+            model->addUserOnset(scoreChannel, tapTime);
+        }
+
+        auto blockEnd = blockStart + numSamples;
+        model->advanceTo((double) blockEnd, sendOnset);
+
+        noteOffs.advance(blockEnd, [this, blockStart](juce::int64 time, int channel, int noteNumber)
+            {
+                outputMidi.addEvent(juce::MidiMessage::noteOff(channel, noteNumber), (int) juce::jmax((juce::int64) 0, time - blockStart));
+            });
+    }
+
+    // Ends every sounding note, when the transport stops or the calibration takes over
+    void stop()
+    {
+        outputMidi.clear();
+        releaseAllNotes(0);
+    }
+
+    const juce::MidiBuffer& getOutput() const { return outputMidi; }
+
+private:
+    // As the processor's own, on this ensemble's channels
+    void sendComputerOnset(const CompiledScore& score, const TempoMap& tempoMap, int playerIndex, int onsetIndex,
+                           double sendTime, juce::int64 blockStart, int numSamples)
+    {
+        double stretch = model->getPeriod(playerIndex) / model->getReferencePeriod();
+        ComputerNotes::send(score, tempoMap, model->getPlayer(playerIndex), channelOffset, stretch, onsetIndex, sendTime,
+                            blockStart, numSamples, noteOffs, outputMidi);
+    }
+
+    void releaseAllNotes(int sampleOffset)
+    {
+        ComputerNotes::releaseAll(noteOffs, outputMidi, sampleOffset);
+    }
+
+    juce::Array<Player> players;
+    int channelOffset;
+    juce::uint64 seed;                      // Each ensemble's players get their own noise
+    std::unique_ptr<EnsembleModel> model;
+    AsynchronyStatistics asynchronyStatistics;
+    NoteOffWheel noteOffs;
+    juce::MidiBuffer outputMidi;            // This block's notes, merged into the processor's output after the join
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GroupEnsemble)
+};
@@ -0,0 +1,154 @@
+#include "LatencyCalibrator.h"
+#include "PluginProcessor.h"
+
+namespace
+{
+    // Stands in for the interface and instruments: the processor's audio output comes back on its
+    // input after a fixed delay, and each note on comes back as a percussive burst after its
+    // channel's latency plus a random jitter of up to +/- jitter samples. Everything lands in a ring of future input samples
+    class SimulatedLoopback
+    {
+    public:
+        SimulatedLoopback(double newSampleRate, juce::int64 newInputLatency, juce::int64 newAudioLatency,
+                          const std::array<juce::int64, 17>& newChannelLatencies, int newJitter)
+            : sampleRate(newSampleRate), inputLatency(newInputLatency), audioLatency(newAudioLatency),
+              channelLatencies(newChannelLatencies), jitter(newJitter), random(1234)
+        {
+        }
+
+        // The input for the block about to be processed, plus a little noise
+        void fillInput(juce::AudioBuffer<float>& buffer)
+        {
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                auto& slot = future[(size_t) ((position + i) & ringMask)];
+                auto sample = slot + noiseLevel * (2.0f * random.nextFloat() - 1.0f);
+                slot = 0.0f;
+
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    buffer.setSample(channel, i, sample);
+            }
+        }
+
+        // What the processor played for the same block
+        void addOutput(const juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi)
+        {
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                future[(size_t) ((position + i + audioLatency + inputLatency) & ringMask)] += buffer.getSample(0, i);
+
+            for (const auto metadata : midi)
+            {
+                auto message = metadata.getMessage();
+                if (!message.isNoteOn())
+                    continue;
+
+                auto offset = jitter > 0 ? random.nextInt(2 * jitter + 1) - jitter : 0;
+                auto arrival = position + metadata.samplePosition + channelLatencies[(size_t) message.getChannel()] + inputLatency + offset;
+                for (int n = 0; n < burstLength; ++n)
+                    future[(size_t) ((arrival + n) & ringMask)] += (float) (0.3 * std::exp(-n / 200.0)
+                                                                            * std::cos(juce::MathConstants<double>::twoPi * 600.0 * n / sampleRate));
+            }
+
+            position += buffer.getNumSamples();
+        }
+
+    private:
+        static constexpr int ringSize = 1 << 16;
+        static constexpr juce::int64 ringMask = ringSize - 1;
+        static constexpr int burstLength = 2048;
+        static constexpr float noiseLevel = 0.001f;
+
+        double sampleRate;
+        juce::int64 inputLatency, audioLatency;
+        std::array<juce::int64, 17> channelLatencies;
+        int jitter;
+        juce::Random random;
+        std::array<float, ringSize> future {};
+        juce::int64 position = 0;
+    };
+}
+
+bool LatencyCalibrator::runSimulatedCheck(double outputLatencyMs, double inputLatencyMs, double jitterMs, juce::String& report)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+    auto toSamples = [](double ms) { return (juce::int64) std::llround(ms * 0.001 * sampleRate); };
+
+    // Player 1 is a user; the computer players' instruments are 3 ms apart so each is told apart
+    juce::Array<Player> players;
+    std::array<juce::int64, 17> channelLatencies {};
+    for (int i = 0; i < maxPlayers; ++i)
+    {
+        players.add(Player(i + 1, i == 0, i + 1, 1.0f, 0.0f, 0.0f, 0.0f, { 0.0, 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0, 0.0 }));
+        channelLatencies[(size_t) i + 1] = toSamples(outputLatencyMs + 3.0 * (i - 1));
+    }
+
+    auto inputLatency = toSamples(inputLatencyMs);
+    auto jitter = (int) toSamples(jitterMs);
+    bool passed = true;
+    report.clear();
+
+    for (auto source : { ClickSource::playerInstrument, ClickSource::audioOutput })
+    {
+        AdaptiveMetronomeAudioProcessor processor;
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        Settings settings;
+        settings.source = source;
+        settings.inputLatencyMs = inputLatencyMs;
+
+        if (!processor.startLatencyCalibration(players, settings))
+        {
+            report << "Could not start the calibration\n";
+            return false;
+        }
+
+        SimulatedLoopback loopback(sampleRate, inputLatency, toSamples(outputLatencyMs), channelLatencies, jitter);
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(4096);
+
+        // Ten minutes at most, in case nothing is ever detected
+        for (int block = 0; block < (int) (600.0 * sampleRate) / blockSize && processor.getLatencyCalibrator().isRunning(); ++block)
+        {
+            loopback.fillInput(buffer);
+            midi.clear();
+            processor.processBlock(buffer, midi);
+            loopback.addOutput(buffer, midi);
+        }
+
+        // A volume edited while the calibration ran must survive it
+        auto editedPlayers = players;
+        editedPlayers.getReference(1).setVolume(0.5f);
+
+        auto results = processor.getLatencyCalibrator().getResults();
+        bool finished = processor.applyLatencyCalibration(editedPlayers);
+        bool editKept = processor.players[1].getVolume() == 0.5f;
+        passed = passed && editKept;
+        report << (source == ClickSource::playerInstrument ? "Instruments:" : "Audio output:")
+               << (editKept ? "" : " volume edit lost FAILED;");
+
+        for (int i = 1; i < maxPlayers; ++i)
+        {
+            const auto& result = results[(size_t) i];
+            auto outputLatency = source == ClickSource::playerInstrument ? channelLatencies[(size_t) i + 1] : toSamples(outputLatencyMs);
+            auto expectedMs = (double) (outputLatency + inputLatency) * 1000.0 / sampleRate - inputLatencyMs;
+            auto errorMs = (double) processor.players[i].getDelay() - expectedMs;
+
+            // Only the instruments jitter; without it every trial must land on the exact sample
+            bool jittered = jitter > 0 && source == ClickSource::playerInstrument;
+            bool playerPassed = finished && result.measured
+                                && (jittered ? std::abs(errorMs) <= jitterMs && result.jitterMs > 0.0
+                                             : std::abs(errorMs) < 1.0e-3 && result.jitterMs == 0.0);
+            passed = passed && playerPassed;
+
+            report << " player " << (i + 1) << " delay " << juce::String(processor.players[i].getDelay(), 3) << " ms (expected "
+                   << juce::String(expectedMs, 3) << ", round trip " << juce::String(result.roundTripSamples, 1) << " samples, jitter "
+                   << juce::String(result.jitterMs, 3) << " ms, " << result.numDetected << " detected)" << (playerPassed ? "" : " FAILED") << ";";
+        }
+
+        report << "\n";
+    }
+
+    return passed;
+}
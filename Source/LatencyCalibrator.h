@@ -0,0 +1,327 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include "Player.h"
+
+//==============================================================================
+// LatencyCalibrator - measures how late each computer player sounds by playing test clicks and
+// listening for them on the plugin's input, through a loopback cable or the player's instrument
+// routed back in.
+//
+// Each trial is a quiet period, which sets the detection threshold above the noise floor, then
+// a click and a listening window. The click is either a MIDI note on the player's channel, so
+// the round trip includes its instrument, or a burst on the plugin's own audio output. It is
+// detected at the first input sample over the threshold, so a clean loopback is measured to the
+// sample. A player's round trip is the median of its trials and its jitter is their spread.
+//
+// Runs on the audio thread in process(). start() and clear() are called under the processor's
+// scoreLock; the results are read on the message thread once isFinished().
+class LatencyCalibrator
+{
+public:
+    static constexpr int maxPlayers = 4;
+    static constexpr int maxTrials = 64;
+
+    enum class ClickSource
+    {
+        playerInstrument,   // A note on each computer player's channel, measured one player at a time
+        audioOutput         // One burst on the plugin's output, measured once for every player
+    };
+
+    struct Settings
+    {
+        ClickSource source = ClickSource::playerInstrument;
+        int numTrials = 12;
+        double inputLatencyMs = 0.0;    // The part of the round trip that is not output latency
+        double quietMs = 100.0;
+        double listenMs = 300.0;        // Longest round trip that can be measured
+        int clickNote = 76;
+    };
+
+    struct PlayerResult
+    {
+        bool measured = false;          // A computer player with at least half its trials detected
+        int numDetected = 0;
+        double roundTripSamples = 0.0;  // Median of the trials
+        double roundTripMs = 0.0;
+        double jitterMs = 0.0;          // Standard deviation of the trials
+        double minMs = 0.0, maxMs = 0.0;
+        double delayMs = 0.0;           // Round trip less the input latency, for Player::delay
+    };
+
+    using Results = std::array<PlayerResult, maxPlayers>;
+
+    LatencyCalibrator() = default;
+
+    // Measures the computer players among players. Returns false if there are none
+    bool start(const Settings& newSettings, const juce::Array<Player>& players, double newSampleRate)
+    {
+        jassert(newSampleRate > 0.0);
+
+        settings = newSettings;
+        settings.numTrials = juce::jlimit(1, maxTrials, settings.numTrials);
+        sampleRate = newSampleRate;
+        results = {};
+
+        numTargets = 0;
+        computerMask = 0;
+        for (int i = 0; i < juce::jmin(players.size(), maxPlayers); ++i)
+        {
+            if (players[i].getIsUser())
+                continue;
+
+            computerMask |= 1u << i;
+            if (settings.source == ClickSource::playerInstrument)
+                targets[(size_t) numTargets++] = { i, players[i].getMidiChannel() };
+        }
+
+        if (computerMask == 0)
+            return false;
+
+        // The output burst stands for every player at once
+        if (settings.source == ClickSource::audioOutput)
+            targets[(size_t) numTargets++] = { -1, 0 };
+
+        quietSamples = msToSamples(settings.quietMs);
+        listenSamples = juce::jmax(msToSamples(settings.listenMs), clickLength() + noteLength());
+        position = 0;
+        currentTarget = 0;
+        trialIndex = 0;
+        numDetected = 0;
+        progress.store(0, std::memory_order_relaxed);
+        startTrial(msToSamples(leadInMs));
+
+        state.store(running, std::memory_order_release);
+        return true;
+    }
+
+    // Stops a run, letting the next process() end its click note, or forgets a finished one
+    void clear()
+    {
+        int expected = running;
+        if (!state.compare_exchange_strong(expected, stopping, std::memory_order_acq_rel))
+            state.store(idle, std::memory_order_release);
+    }
+
+    bool isRunning() const { return state.load(std::memory_order_acquire) == running; }
+    bool isFinished() const { return state.load(std::memory_order_acquire) == finished; }
+
+    // Audio thread. True while process() should be given the block
+    bool isActive() const
+    {
+        auto current = state.load(std::memory_order_acquire);
+        return current == running || current == stopping;
+    }
+
+    // Valid once isFinished(), until the next start()
+    const Results& getResults() const { return results; }
+
+    // 0 to 1 through the run
+    double getProgress() const
+    {
+        return (double) progress.load(std::memory_order_relaxed) / (double) juce::jmax(1, numTargets * settings.numTrials);
+    }
+
+    // Audio thread. Reads the input in buffer, then replaces it with the clicks; note clicks go to midiOut.
+    // Nothing else is heard while calibrating, so the input can never feed back to the output
+    void process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiOut)
+    {
+        if (state.load(std::memory_order_acquire) == stopping)
+        {
+            if (targets[(size_t) currentTarget].midiChannel > 0 && position > clickAt && position <= clickAt + noteLength())
+                midiOut.addEvent(juce::MidiMessage::noteOff(targets[(size_t) currentTarget].midiChannel, settings.clickNote), 0);
+
+            buffer.clear();
+            state.store(idle, std::memory_order_release);
+            return;
+        }
+
+        if (state.load(std::memory_order_relaxed) != running)
+            return;
+
+        int numSamples = buffer.getNumSamples();
+        auto blockStart = position;
+
+        for (int i = 0; i < numSamples && state.load(std::memory_order_relaxed) == running; ++i, ++position)
+        {
+            float level = 0.0f;
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                level = juce::jmax(level, std::abs(buffer.getSample(channel, i)));
+
+            if (position < clickAt)
+            {
+                noisePeak = juce::jmax(noisePeak, level);
+                continue;
+            }
+
+            if (position == clickAt)
+            {
+                threshold = juce::jmax(minimumThreshold, noisePeak * noiseMargin);
+                if (targets[(size_t) currentTarget].midiChannel > 0)
+                    midiOut.addEvent(juce::MidiMessage::noteOn(targets[(size_t) currentTarget].midiChannel, settings.clickNote, 1.0f), i);
+            }
+
+            if (position == clickAt + noteLength() && targets[(size_t) currentTarget].midiChannel > 0)
+                midiOut.addEvent(juce::MidiMessage::noteOff(targets[(size_t) currentTarget].midiChannel, settings.clickNote), i);
+
+            if (detectedAt < 0 && level >= threshold && noisePeak <= maximumNoise)
+                detectedAt = position;
+
+            if (position + 1 >= clickAt + listenSamples)
+                finishTrial();
+        }
+
+        // The output is silence apart from the bursts of an audioOutput run
+        buffer.clear();
+        if (settings.source == ClickSource::audioOutput)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto n = blockStart + i - lastClickAt;
+                if (n < 0 || n >= clickLength())
+                    continue;
+
+                auto sample = clickSample((int) n);
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    buffer.setSample(channel, i, sample);
+            }
+        }
+    }
+
+    // Runs a calibration through a whole processor against a simulated loopback with known
+    // latencies and checks the delays it sets. Blocks until done
+    static bool runSimulatedCheck(double outputLatencyMs, double inputLatencyMs, double jitterMs, juce::String& report);
+
+private:
+    enum State
+    {
+        idle,
+        running,
+        stopping,
+        finished
+    };
+
+    struct Target
+    {
+        int playerIndex;    // -1 for every computer player
+        int midiChannel;    // 0 for the audio output
+    };
+
+    static constexpr double leadInMs = 250.0;       // Before the first trial, for the ensemble's notes to die away
+    static constexpr double noteLengthMs = 50.0;
+    static constexpr double clickLengthMs = 2.0;
+    static constexpr double clickFrequency = 1000.0;
+    static constexpr float minimumThreshold = 0.01f;    // -40 dBFS
+    static constexpr float noiseMargin = 4.0f;
+    static constexpr float maximumNoise = 0.25f;        // Louder than this before the click and the trial is not counted
+
+    juce::int64 msToSamples(double ms) const { return (juce::int64) std::llround(ms * 0.001 * sampleRate); }
+    juce::int64 noteLength() const { return msToSamples(noteLengthMs); }
+    juce::int64 clickLength() const { return juce::jmax((juce::int64) 1, msToSamples(clickLengthMs)); }
+
+    // A decaying cosine that starts at its peak, so its first sample is the loudest
+    float clickSample(int n) const
+    {
+        auto fade = 1.0 - (double) n / (double) clickLength();
+        return (float) (0.5 * fade * std::cos(juce::MathConstants<double>::twoPi * clickFrequency * n / sampleRate));
+    }
+
+    void startTrial(juce::int64 extraQuietSamples)
+    {
+        clickAt = position + 1 + quietSamples + extraQuietSamples;
+        lastClickAt = clickAt;
+        noisePeak = 0.0f;
+        detectedAt = -1;
+    }
+
+    void finishTrial()
+    {
+        if (detectedAt >= 0)
+            trials[(size_t) numDetected++] = detectedAt - clickAt;
+
+        progress.fetch_add(1, std::memory_order_relaxed);
+
+        if (++trialIndex < settings.numTrials)
+        {
+            startTrial(0);
+            return;
+        }
+
+        storeResult(targets[(size_t) currentTarget]);
+        trialIndex = 0;
+        numDetected = 0;
+
+        if (++currentTarget < numTargets)
+        {
+            startTrial(0);
+            return;
+        }
+
+        state.store(finished, std::memory_order_release);
+    }
+
+    void storeResult(const Target& target)
+    {
+        // Insertion sort - at most maxTrials values
+        for (int i = 1; i < numDetected; ++i)
+            for (int j = i; j > 0 && trials[(size_t) j - 1] > trials[(size_t) j]; --j)
+                std::swap(trials[(size_t) j - 1], trials[(size_t) j]);
+
+        PlayerResult result;
+        result.numDetected = numDetected;
+        result.measured = numDetected > 0 && 2 * numDetected >= settings.numTrials;
+
+        if (numDetected > 0)
+        {
+            result.roundTripSamples = 0.5 * (double) (trials[(size_t) (numDetected - 1) / 2] + trials[(size_t) numDetected / 2]);
+
+            double mean = 0.0;
+            for (int i = 0; i < numDetected; ++i)
+                mean += (double) trials[(size_t) i];
+            mean /= numDetected;
+
+            double sumSquares = 0.0;
+            for (int i = 0; i < numDetected; ++i)
+                sumSquares += ((double) trials[(size_t) i] - mean) * ((double) trials[(size_t) i] - mean);
+
+            auto toMs = 1000.0 / sampleRate;
+            result.roundTripMs = result.roundTripSamples * toMs;
+            result.jitterMs = std::sqrt(sumSquares / numDetected) * toMs;
+            result.minMs = (double) trials[0] * toMs;
+            result.maxMs = (double) trials[(size_t) numDetected - 1] * toMs;
+            result.delayMs = juce::jmax(0.0, result.roundTripMs - settings.inputLatencyMs);
+        }
+
+        for (int i = 0; i < maxPlayers; ++i)
+            if ((target.playerIndex < 0 && (computerMask & (1u << i)) != 0) || target.playerIndex == i)
+                results[(size_t) i] = result;
+    }
+
+    Settings settings;
+    double sampleRate = 44100.0;
+    std::array<Target, maxPlayers> targets {};
+    int numTargets = 0;
+    juce::uint32 computerMask = 0;
+
+    // Audio thread while running
+    juce::int64 position = 0;           // Samples since start()
+    juce::int64 quietSamples = 0, listenSamples = 0;
+    int currentTarget = 0;
+    int trialIndex = 0;
+    juce::int64 clickAt = 0;            // This trial's click
+    juce::int64 lastClickAt = 0;        // The burst being played, which can outlast its trial's block
+    float noisePeak = 0.0f;
+    float threshold = 1.0f;
+    juce::int64 detectedAt = -1;
+    std::array<juce::int64, maxTrials> trials {};   // Round trips in samples of this target's detected trials
+    int numDetected = 0;
+
+    Results results;                    // Written by the audio thread before state becomes finished
+    std::atomic<int> state { idle };
+    std::atomic<int> progress { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyCalibrator)
+};
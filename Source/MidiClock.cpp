@@ -0,0 +1,237 @@
+#include "MidiClock.h"
+#include "PluginProcessor.h"
+#include "ScoreCache.h"
+
+namespace
+{
+    struct ClockPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override { return info; }
+        PositionInfo info;
+    };
+
+    // What one session sent on the MIDI output
+    struct Session
+    {
+        std::vector<juce::int64> pulses;                        // Before the seek
+        int firstPulse = 0;                                     // Number of pulses[0], from the song position started at
+        std::array<std::vector<juce::int64>, 17> noteOns;      // Distinct note on times per channel, before the seek
+        bool startedFromTop = false;
+        bool relocatedInOrder = false;                          // Stop, Song Position Pointer, Continue at the seek
+        int songPosition = -1;
+        juce::int64 firstPulseAfterSeek = -1;
+        double processSeconds = 0.0;
+        int numBlocks = 0;
+    };
+
+    // Plays the score from the top to seekAt, then from seekTo to endSample
+    Session play(const juce::File& midiFile, const juce::Array<Player>& players, double sampleRate, int blockSize,
+                 bool clockEnabled, juce::int64 seekAt, juce::int64 seekTo, juce::int64 endSample)
+    {
+        AdaptiveMetronomeAudioProcessor processor;
+        processor.UpdatePlayers(players);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.loadScore(midiFile);
+        processor.setMidiClockEnabled(clockEnabled);
+
+        ClockPlayHead playHead;
+        playHead.info.setIsPlaying(true);
+        processor.setPlayHead(&playHead);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(65536);
+
+        Session session;
+        auto position = (juce::int64) 0;
+        bool seeked = false;
+        int stage = 0;      // Through Stop, Song Position Pointer, Continue after the seek
+
+        while (position < endSample)
+        {
+            if (!seeked && position >= seekAt)
+            {
+                position = seekTo;
+                seeked = true;
+            }
+
+            buffer.clear();
+            midi.clear();
+            playHead.info.setTimeInSamples(position);
+
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            session.processSeconds += juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            ++session.numBlocks;
+
+            for (const auto metadata : midi)
+            {
+                auto message = metadata.getMessage();
+                auto time = position + metadata.samplePosition;
+
+                if (message.isMidiStart())
+                {
+                    session.startedFromTop = !seeked && time == 0 && session.pulses.empty();
+                }
+                else if (!seeked && message.isSongPositionPointer() && session.pulses.empty())
+                {
+                    session.firstPulse = message.getSongPositionPointerMidiBeat() * MidiClock::pulsesPerSixteenth;
+                }
+                else if (message.isMidiClock())
+                {
+                    if (!seeked)
+                        session.pulses.push_back(time);
+                    else if (session.firstPulseAfterSeek < 0)
+                        session.firstPulseAfterSeek = time;
+                }
+                else if (seeked)
+                {
+                    if (stage == 0 && message.isMidiStop())
+                        stage = 1;
+                    else if (stage == 1 && message.isSongPositionPointer())
+                    {
+                        session.songPosition = message.getSongPositionPointerMidiBeat();
+                        stage = 2;
+                    }
+                    else if (stage == 2 && message.isMidiContinue())
+                        session.relocatedInOrder = session.firstPulseAfterSeek < 0;
+                }
+                else if (message.isNoteOn())
+                {
+                    auto& times = session.noteOns[(size_t) message.getChannel()];
+                    if (times.empty() || times.back() != time)
+                        times.push_back(time);
+                }
+            }
+
+            position += blockSize;
+        }
+
+        processor.setPlayHead(nullptr);
+        return session;
+    }
+
+    struct ClockMetrics
+    {
+        double maxJitterSamples = 0.0;  // Largest change between consecutive pulse intervals
+        double rmsTrackingMs = 0.0;     // Clock against the ensemble's mean heard onset
+        double maxTrackingMs = 0.0;
+        int numOnsets = 0;
+    };
+
+    // Ignores the first bar while the clock settles
+    ClockMetrics measure(const Session& session, const CompiledScore& score, const juce::Array<Player>& players, double sampleRate)
+    {
+        ClockMetrics metrics;
+        const auto& pulses = session.pulses;
+        auto settlePulses = (size_t) (4 * MidiClock::pulsesPerQuarterNote);
+
+        for (size_t i = juce::jmax((size_t) 2, settlePulses); i < pulses.size(); ++i)
+        {
+            auto change = std::abs((double) ((pulses[i] - pulses[i - 1]) - (pulses[i - 1] - pulses[i - 2])));
+            metrics.maxJitterSamples = juce::jmax(metrics.maxJitterSamples, change);
+        }
+
+        // Each channel's n-th note on time belongs to the n-th score onset that channel plays in
+        std::array<size_t, 17> next {};
+        double sumSquares = 0.0;
+        for (int onset = 0; onset < score.getNumOnsets(); ++onset)
+        {
+            double heardSum = 0.0;
+            int numHeard = 0;
+            for (const auto& player : players)
+            {
+                auto channel = (size_t) player.getMidiChannel();
+                if (!score.hasChannel(onset, player.getMidiChannel()) || next[channel] >= session.noteOns[channel].size())
+                    continue;
+
+                heardSum += (double) session.noteOns[channel][next[channel]++] + player.getDelay() * 0.001 * sampleRate;
+                ++numHeard;
+            }
+
+            // The clock's time for this onset's position, between the pulses either side
+            auto pulse = score.getOnsetBeats(onset) * MidiClock::pulsesPerQuarterNote - session.firstPulse;
+            auto index = (size_t) std::floor(pulse);
+            if (numHeard == 0 || pulse < 0.0 || index < settlePulses || index + 1 >= pulses.size())
+                continue;
+
+            auto clockTime = (double) pulses[index] + (pulse - (double) index) * (double) (pulses[index + 1] - pulses[index]);
+            auto errorMs = (clockTime - heardSum / numHeard) * 1000.0 / sampleRate;
+            sumSquares += errorMs * errorMs;
+            metrics.maxTrackingMs = juce::jmax(metrics.maxTrackingMs, std::abs(errorMs));
+            ++metrics.numOnsets;
+        }
+
+        metrics.rmsTrackingMs = metrics.numOnsets > 0 ? std::sqrt(sumSquares / metrics.numOnsets) : 0.0;
+        return metrics;
+    }
+}
+
+bool MidiClock::runSimulatedCheck(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report)
+{
+    constexpr double sampleRate = 48000.0;
+    report.clear();
+
+    juce::SharedResourcePointer<ScoreCache> scoreCache;
+    auto score = scoreCache->acquire(midiFile, ScoreCompiler::defaultChordToleranceMs);
+    if (score == nullptr || score->getNumOnsets() < 2 || players.size() == 0)
+    {
+        scoreCache->release(score);
+        report = "Could not load " + midiFile.getFileName();
+        return false;
+    }
+
+    // The ensemble plays on its own: every player is a computer player. The steady ensemble has
+    // no noise or delays and so keeps the score's tempo exactly; the adaptive one is as configured
+    juce::Array<Player> adaptive, steady;
+    for (auto player : players)
+    {
+        player.setIsUser(false);
+        adaptive.add(player);
+
+        player.setDelay(0.0f);
+        player.setMotorNoiseSTD(0.0f);
+        player.setTimeKeeperNoiseSTD(0.0f);
+        steady.add(player);
+    }
+
+    TempoMap tempoMap = score->tempoMap;
+    tempoMap.prepare(sampleRate);
+    auto lastOnset = (juce::int64) tempoMap.tickToSample(score->onsets.back().tick);
+    auto seekAt = lastOnset;
+    auto seekTo = (juce::int64) tempoMap.tickToSample(score->onsets[(size_t) score->getNumOnsets() / 2].tick) + 1;
+    auto endSample = lastOnset + (juce::int64) sampleRate;
+
+    bool passed = true;
+    for (int blockSize : { 32, 256, 1024, 4096 })
+    {
+        auto steadySession = play(midiFile, steady, sampleRate, blockSize, true, seekAt, seekTo, endSample);
+        auto adaptiveSession = play(midiFile, adaptive, sampleRate, blockSize, true, seekAt, seekTo, endSample);
+        auto silentSession = play(midiFile, adaptive, sampleRate, blockSize, false, seekAt, seekTo, endSample);
+
+        auto steadyMetrics = measure(steadySession, *score, steady, sampleRate);
+        auto adaptiveMetrics = measure(adaptiveSession, *score, adaptive, sampleRate);
+
+        // Each pulse is rounded to its nearest sample, so a steady tempo's intervals differ by one sample at most.
+        // The clock resumes on the sixteenth after the seek
+        auto sixteenth = tempoMap.getSecondsPerQuarterNoteAt(score->onsets.back().tick) * sampleRate / 4.0;
+        bool messagesPassed = steadySession.startedFromTop && steadySession.relocatedInOrder && adaptiveSession.relocatedInOrder
+                              && steadySession.firstPulseAfterSeek >= seekTo && (double) (steadySession.firstPulseAfterSeek - seekTo) <= sixteenth + 1.0;
+        bool steadyPassed = steadyMetrics.numOnsets > 0 && steadyMetrics.maxJitterSamples <= 1.0 && steadyMetrics.maxTrackingMs < 0.1;
+        bool adaptivePassed = adaptiveMetrics.numOnsets > 0 && adaptiveMetrics.rmsTrackingMs < maxTrackingErrorMs;
+        passed = passed && messagesPassed && steadyPassed && adaptivePassed;
+
+        auto costUs = (adaptiveSession.processSeconds - silentSession.processSeconds) * 1.0e6 / juce::jmax(1, adaptiveSession.numBlocks);
+        report << "Block size " << blockSize << ": " << (int) steadySession.pulses.size() << " pulses, steady jitter "
+               << juce::String(steadyMetrics.maxJitterSamples * 1.0e6 / sampleRate, 1) << " us, tracking "
+               << juce::String(steadyMetrics.maxTrackingMs, 3) << " ms; adaptive jitter "
+               << juce::String(adaptiveMetrics.maxJitterSamples * 1.0e6 / sampleRate, 1) << " us, tracking "
+               << juce::String(adaptiveMetrics.rmsTrackingMs, 2) << " ms rms, " << juce::String(adaptiveMetrics.maxTrackingMs, 2)
+               << " ms max; song position " << steadySession.songPosition << "; clock cost " << juce::String(costUs, 2) << " us per block"
+               << (messagesPassed ? "" : " MESSAGES FAILED") << (steadyPassed ? "" : " STEADY FAILED")
+               << (adaptivePassed ? "" : " ADAPTIVE FAILED") << "\n";
+    }
+
+    scoreCache->release(score);
+    return passed;
+}
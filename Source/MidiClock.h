@@ -0,0 +1,159 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+#include "Player.h"
+
+//==============================================================================
+// MidiClock - 24 ppqn MIDI clock, with Start, Continue, Stop and Song Position Pointer, that
+// follows the tempo the ensemble actually plays at rather than the score's.
+//
+// The clock runs from a phase in pulses that advances at a rate per sample. follow() is given
+// where the ensemble is (a sample time and the score position it plays there, in quarter notes)
+// and how fast it is going each time the model steps. The tempo is smoothed over a couple of
+// beats, and the clock's phase is pulled towards the ensemble's by adjusting the rate by at most
+// maxRateAdjustment, so an external sequencer sees a steady tempo that does not drift away from
+// the players. Pulses land on the nearest sample to their exact time, so with a steady tempo
+// the only jitter is that rounding, whatever the block size.
+//
+// Audio thread only, after prepare(). Everything here is allocation free.
+class MidiClock
+{
+public:
+    static constexpr int pulsesPerQuarterNote = 24;
+    static constexpr int pulsesPerSixteenth = pulsesPerQuarterNote / 4;    // Song position units
+    static constexpr double tempoSmoothingQuarters = 2.0;   // Time constant of the tempo estimate
+    static constexpr double phaseGain = 0.5;                // Rate adjustment per quarter note of phase error
+    static constexpr double maxRateAdjustment = 0.03;
+
+    MidiClock() = default;
+
+    void prepare(double newSampleRate)
+    {
+        jassert(newSampleRate > 0.0);
+        sampleRate = newSampleRate;
+        running = false;
+        pendingStart = pendingStop = false;
+    }
+
+    bool isRunning() const { return running || pendingStart; }
+
+    // Smoothed ensemble tempo, for display
+    double getBeatsPerMinute() const { return samplesPerQuarter > 0.0 ? 60.0 * sampleRate / samplesPerQuarter : 0.0; }
+
+    // (Re)starts the clock from the ensemble's position at sample time. The messages go out at
+    // the start of the next process(): Start from the top of the song, otherwise Stop if running,
+    // Song Position Pointer and Continue. Clock pulses resume on the next sixteenth note
+    void locate(double time, double quarterNotes, double newSamplesPerQuarter)
+    {
+        jassert(newSamplesPerQuarter > 0.0);
+        samplesPerQuarter = newSamplesPerQuarter;
+        rate = (double) pulsesPerQuarterNote / samplesPerQuarter;
+
+        // Song position is counted in sixteenths, so the clock waits for the next one. Within a
+        // pulse of one, as when the transport starts at the top, it starts there and catches up
+        auto sixteenths = quarterNotes * 4.0;
+        auto nearest = std::round(sixteenths);
+        sixteenths = std::abs(sixteenths - nearest) * pulsesPerSixteenth <= 1.0 ? nearest : std::ceil(sixteenths);
+        songPosition = (int) juce::jlimit(0.0, (double) maxSongPosition, sixteenths);
+        nextPulse = (double) songPosition * pulsesPerSixteenth;
+        phase = quarterNotes * pulsesPerQuarterNote;
+        phaseTime = time;
+        lastFollowQuarters = quarterNotes;
+
+        pendingStop = running;
+        pendingStart = true;
+    }
+
+    // Stops the clock at the start of the next process()
+    void stop()
+    {
+        pendingStop = running;
+        pendingStart = false;
+        running = false;
+    }
+
+    // The ensemble plays score position quarterNotes at sample time, going at newSamplesPerQuarter
+    void follow(double time, double quarterNotes, double newSamplesPerQuarter)
+    {
+        if (!isRunning() || newSamplesPerQuarter <= 0.0)
+            return;
+
+        // Weighted by how far the ensemble has moved, so dense passages do not smooth any faster
+        auto quarters = juce::jmax(0.0, quarterNotes - lastFollowQuarters);
+        lastFollowQuarters = juce::jmax(lastFollowQuarters, quarterNotes);
+        samplesPerQuarter += (1.0 - std::exp(-quarters / tempoSmoothingQuarters)) * (newSamplesPerQuarter - samplesPerQuarter);
+
+        // Where the clock would be at that time without correction, against where the ensemble is
+        auto baseRate = (double) pulsesPerQuarterNote / samplesPerQuarter;
+        auto error = (phase + (time - phaseTime) * baseRate) / pulsesPerQuarterNote - quarterNotes;
+        rate = baseRate * (1.0 + juce::jlimit(-maxRateAdjustment, maxRateAdjustment, -phaseGain * error));
+    }
+
+    // Adds this block's messages to midiOut. blockStart is the block's first sample in host time
+    void process(juce::int64 blockStart, int numSamples, juce::MidiBuffer& midiOut)
+    {
+        if (pendingStop)
+        {
+            midiOut.addEvent(juce::MidiMessage::midiStop(), 0);
+            pendingStop = false;
+        }
+
+        if (pendingStart)
+        {
+            if (songPosition == 0)
+            {
+                midiOut.addEvent(juce::MidiMessage::midiStart(), 0);
+            }
+            else
+            {
+                midiOut.addEvent(juce::MidiMessage::songPositionPointer(songPosition), 0);
+                midiOut.addEvent(juce::MidiMessage::midiContinue(), 0);
+            }
+
+            pendingStart = false;
+            running = true;
+        }
+
+        if (!running)
+            return;
+
+        // Phase and rate were last set at phaseTime, which may be before this block after a locate
+        auto blockEnd = (double) (blockStart + numSamples);
+        for (;;)
+        {
+            auto pulseTime = phaseTime + (nextPulse - phase) / rate;
+            auto pulseSample = (juce::int64) std::floor(pulseTime + 0.5);
+            if ((double) pulseSample >= blockEnd)
+                break;
+
+            midiOut.addEvent(juce::MidiMessage::midiClock(), (int) juce::jmax((juce::int64) 0, pulseSample - blockStart));
+            nextPulse += 1.0;
+        }
+
+        phase += (blockEnd - phaseTime) * rate;
+        phaseTime = blockEnd;
+    }
+
+    // Plays the score through a whole processor at several block sizes, with every player a computer
+    // player, and reports the clock's jitter, how closely it follows the ensemble and what it costs.
+    // Blocks until done
+    static bool runSimulatedCheck(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report);
+
+private:
+    static constexpr int maxSongPosition = 16383;   // 14 bits
+    static constexpr double maxTrackingErrorMs = 20.0;  // RMS, for runSimulatedCheck
+
+    double sampleRate = 44100.0;
+    double samplesPerQuarter = 0.0;     // Smoothed ensemble tempo
+    double rate = 0.0;                  // Pulses per sample, with the phase correction
+    double phase = 0.0;                 // Pulses since the top of the song, at phaseTime
+    double phaseTime = 0.0;
+    double nextPulse = 0.0;             // Number of the next pulse to send
+    double lastFollowQuarters = 0.0;
+    int songPosition = 0;
+    bool running = false;
+    bool pendingStart = false, pendingStop = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiClock)
+};
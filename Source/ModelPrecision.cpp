@@ -0,0 +1,199 @@
+#include "ModelPrecision.h"
+#include "EnsembleModel.h"
+#include "Score.h"
+#include "TempoMap.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ModelPrecision
+{
+    namespace
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr double longRunHours = 1.0;
+        constexpr double minBenchmarkSeconds = 0.25;    // Per model and score
+
+        struct Run
+        {
+            std::vector<double> sendTimes;      // By onset then player, NaN where the player has no notes
+            double onsetsPerSecond = 0.0;
+            double checksum = 0.0;              // Keeps the timed runs from being optimised away
+        };
+
+        // One run over the score for its onsets, then whole runs from the start again until timed for long enough
+        template <typename Model>
+        Run play(const CompiledScore& score, const TempoMap& tempoMap, const juce::Array<Player>& players)
+        {
+            Model model(score, tempoMap, players);
+            int numPlayers = model.getNumPlayers();
+            constexpr double end = std::numeric_limits<double>::max();
+
+            Run run;
+            run.sendTimes.assign((size_t) score.getNumOnsets() * (size_t) numPlayers, std::numeric_limits<double>::quiet_NaN());
+            model.relocate(0.0);
+            model.advanceTo(end, [&run, numPlayers](int playerIndex, int onsetIndex, double sendTime)
+                {
+                    run.sendTimes[(size_t) onsetIndex * (size_t) numPlayers + (size_t) playerIndex] = sendTime;
+                });
+
+            int numRuns = 0;
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            double seconds = 0.0;
+            do
+            {
+                model.relocate(0.0);
+                model.advanceTo(end, [&run](int, int, double sendTime) { run.checksum += sendTime; });
+                ++numRuns;
+                seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            }
+            while (seconds < minBenchmarkSeconds);
+
+            run.onsetsPerSecond = numRuns * (double) (score.getNumOnsets() - 1) / juce::jmax(1.0e-9, seconds);
+            return run;
+        }
+
+        struct Divergence
+        {
+            double maxOnsetMs = 0.0;
+            double rmsOnsetMs = 0.0;
+            double maxAsynchronyMs = 0.0;       // Each player to the mean of the players at the onset
+            double maxOnsetSeconds = 0.0;       // Score time of the largest onset difference
+        };
+
+        Divergence compare(const Run& reference, const Run& single, int numPlayers)
+        {
+            Divergence divergence;
+            double sumSquares = 0.0;
+            int count = 0;
+            auto numOnsets = reference.sendTimes.size() / (size_t) juce::jmax(1, numPlayers);
+
+            for (size_t onset = 0; onset < numOnsets; ++onset)
+            {
+                const double* referenceTimes = reference.sendTimes.data() + onset * (size_t) numPlayers;
+                const double* singleTimes = single.sendTimes.data() + onset * (size_t) numPlayers;
+                double referenceMean = 0.0, singleMean = 0.0;
+                int numPlayed = 0;
+
+                for (int i = 0; i < numPlayers; ++i)
+                {
+                    if (std::isnan(referenceTimes[i]) || std::isnan(singleTimes[i]))
+                        continue;
+
+                    double differenceMs = std::abs(singleTimes[i] - referenceTimes[i]) * 1000.0 / sampleRate;
+                    if (differenceMs > divergence.maxOnsetMs)
+                    {
+                        divergence.maxOnsetMs = differenceMs;
+                        divergence.maxOnsetSeconds = referenceTimes[i] / sampleRate;
+                    }
+                    sumSquares += differenceMs * differenceMs;
+                    ++count;
+
+                    referenceMean += referenceTimes[i];
+                    singleMean += singleTimes[i];
+                    ++numPlayed;
+                }
+
+                if (numPlayed < 2)
+                    continue;
+
+                referenceMean /= numPlayed;
+                singleMean /= numPlayed;
+                for (int i = 0; i < numPlayers; ++i)
+                {
+                    if (std::isnan(referenceTimes[i]) || std::isnan(singleTimes[i]))
+                        continue;
+
+                    double asynchronyMs = std::abs((singleTimes[i] - singleMean) - (referenceTimes[i] - referenceMean)) * 1000.0 / sampleRate;
+                    divergence.maxAsynchronyMs = juce::jmax(divergence.maxAsynchronyMs, asynchronyMs);
+                }
+            }
+
+            divergence.rmsOnsetMs = count > 0 ? std::sqrt(sumSquares / count) : 0.0;
+            return divergence;
+        }
+
+        // Quarter notes at 120 bpm on every player's channel
+        CompiledScore::Ptr makeSteadyScore(const juce::Array<Player>& players, double hours)
+        {
+            constexpr int ticksPerQuarter = 480;
+            juce::MidiMessageSequence track;
+            track.addEvent(juce::MidiMessage::tempoMetaEvent(500000));
+
+            auto numBeats = (int) (hours * 3600.0 * 2.0);
+            for (int beat = 0; beat < numBeats; ++beat)
+            {
+                for (const auto& player : players)
+                {
+                    auto noteOn = juce::MidiMessage::noteOn(player.getMidiChannel(), 60, (juce::uint8) 100);
+                    noteOn.setTimeStamp(beat * ticksPerQuarter);
+                    track.addEvent(noteOn);
+
+                    auto noteOff = juce::MidiMessage::noteOff(player.getMidiChannel(), 60);
+                    noteOff.setTimeStamp(beat * ticksPerQuarter + ticksPerQuarter / 2);
+                    track.addEvent(noteOff);
+                }
+            }
+            track.sort();
+
+            juce::MidiFile midiFile;
+            midiFile.setTicksPerQuarterNote(ticksPerQuarter);
+            midiFile.addTrack(track);
+            return ScoreCompiler::compile(midiFile);
+        }
+
+        bool checkScore(const juce::String& name, const CompiledScore& score, const juce::Array<Player>& players, juce::String& report)
+        {
+            TempoMap tempoMap = score.tempoMap;
+            tempoMap.prepare(sampleRate);
+
+            auto reference = play<EnsembleModel>(score, tempoMap, players);
+            auto single = play<FloatEnsembleModel>(score, tempoMap, players);
+            auto divergence = compare(reference, single, juce::jmin(players.size(), EnsembleModel::maxPlayers));
+            bool passed = divergence.maxAsynchronyMs <= inaudibleMs;
+
+            report << name << ", " << score.getNumOnsets() << " onsets over "
+                   << juce::String(tempoMap.tickToSample(score.onsets.back().tick) / sampleRate / 60.0, 1) << " min:\n"
+                   << "  onset difference " << juce::String(divergence.rmsOnsetMs, 4) << " ms RMS, "
+                   << juce::String(divergence.maxOnsetMs, 4) << " ms max (at " << juce::String(divergence.maxOnsetSeconds, 0) << " s)\n"
+                   << "  asynchrony difference " << juce::String(divergence.maxAsynchronyMs, 4) << " ms max"
+                   << (passed ? "\n" : " ABOVE " + juce::String(inaudibleMs, 1) + " ms\n")
+                   << "  double " << juce::String(reference.onsetsPerSecond / 1.0e6, 2) << " M onsets/s, float "
+                   << juce::String(single.onsetsPerSecond / 1.0e6, 2) << " M onsets/s, speedup "
+                   << juce::String(single.onsetsPerSecond / juce::jmax(1.0, reference.onsetsPerSecond), 2) << "\n";
+            return passed;
+        }
+    }
+
+    bool runCheck(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report)
+    {
+        report.clear();
+
+        if (players.size() == 0)
+        {
+            report = "No players";
+            return false;
+        }
+
+        // Every player is a computer player, so both models step without waiting for taps
+        juce::Array<Player> computerPlayers;
+        for (auto player : players)
+        {
+            player.setIsUser(false);
+            computerPlayers.add(player);
+        }
+
+        auto score = ScoreCompiler::compile(midiFile);
+        if (score == nullptr || score->getNumOnsets() == 0)
+        {
+            report = "Could not load " + midiFile.getFileName();
+            return false;
+        }
+
+        bool passed = checkScore(midiFile.getFileName(), *score, computerPlayers, report);
+
+        auto steadyScore = makeSteadyScore(computerPlayers, longRunHours);
+        passed = checkScore("Steady beats", *steadyScore, computerPlayers, report) && passed;
+        return passed;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Player.h"
+
+//==============================================================================
+// ModelPrecision - compares FloatEnsembleModel with the double EnsembleModel it is built from.
+//
+// Both models are run with the same players, seed and noise over the loaded score and over an
+// hour of steady beats, with every player a computer player. The check reports how far the
+// float onsets drift from the double ones, how far the asynchronies between the players differ
+// (what a listener hears), and how many onsets per second each model steps.
+//
+// The model holds onsets relative to their score onsets and periods relative to its reference
+// period, so float rounding does not grow with the distance from the start of the score. What
+// does build up moves the whole ensemble together; the asynchronies stay close, and the check
+// passes while they are within inaudibleMs.
+namespace ModelPrecision
+{
+    constexpr double inaudibleMs = 1.0;     // Largest asynchrony difference accepted
+
+    // Blocks until done. report receives the divergence and throughput either way
+    bool runCheck(const juce::File& midiFile, const juce::Array<Player>& players, juce::String& report);
+}
@@ -0,0 +1,684 @@
+#include "NetworkEnsemble.h"
+#include "PluginProcessor.h"
+#include "Score.h"
+
+#if JUCE_WINDOWS
+ #include <winsock2.h>
+ #include <ws2tcpip.h>
+#else
+ #include <arpa/inet.h>
+ #include <netdb.h>
+#endif
+
+namespace
+{
+    // Packet layout, little-endian:
+    //   header    uint32 magic, uint8 version, uint8 type, uint16 count, uint32 sender id
+    //   onsets    uint32 first sequence, int64 send time, then count x (int32 onset index, uint8 channel, int64 time ns)
+    //   sync      int64 t1, int64 score start or 0 (request)
+    //             int64 t1, int64 t2, int64 t3     (response)
+    constexpr juce::uint32 packetMagic = 0x454e4d41;   // "AMNE"
+    constexpr juce::uint8 packetVersion = 2;
+
+    enum PacketType : juce::uint8
+    {
+        onsetsPacket = 1,
+        syncRequestPacket = 2,
+        syncResponsePacket = 3
+    };
+
+    struct PacketWriter
+    {
+        template <typename T>
+        void write(T value)
+        {
+            auto bits = (juce::uint64) value;
+            for (size_t i = 0; i < sizeof(T); ++i)
+                data[(size_t) size++] = (juce::uint8) (bits >> (8 * i));
+        }
+
+        std::array<juce::uint8, 128> data {};
+        int size = 0;
+    };
+
+    struct PacketReader
+    {
+        template <typename T>
+        T read()
+        {
+            if (position + (int) sizeof(T) > size)
+            {
+                isValid = false;
+                return {};
+            }
+
+            juce::uint64 bits = 0;
+            for (size_t i = 0; i < sizeof(T); ++i)
+                bits |= (juce::uint64) data[position++] << (8 * i);
+            return (T) bits;
+        }
+
+        const juce::uint8* data;
+        int size;
+        int position = 0;
+        bool isValid = true;
+    };
+
+    // The numeric IPv4 address a peer's packets arrive from, or the host as given if it does not resolve
+    juce::String resolveHost(const juce::String& host)
+    {
+        addrinfo hints {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host.toRawUTF8(), nullptr, &hints, &result) != 0 || result == nullptr)
+            return host;
+
+        char text[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr, text, sizeof(text));
+        freeaddrinfo(result);
+        return juce::String(text);
+    }
+}
+
+//==============================================================================
+NetworkEnsemble::NetworkEnsemble() : juce::Thread("Network Ensemble") {}
+
+NetworkEnsemble::~NetworkEnsemble()
+{
+    stop();
+}
+
+bool NetworkEnsemble::start(int localPort, const juce::StringArray& peerAddresses)
+{
+    stop();
+
+    socket = std::make_unique<juce::DatagramSocket>(false);
+    if (!socket->bindToPort(localPort))
+    {
+        DBG("Could not bind UDP port " + juce::String(localPort));
+        socket.reset();
+        return false;
+    }
+
+    numConfiguredPeers = 0;
+    for (auto& peer : peers)
+    {
+        peer.active = false;
+        peer.id = 0;
+    }
+
+    for (const auto& address : peerAddresses)
+    {
+        auto host = address.upToLastOccurrenceOf(":", false, false).trim();
+        int port = address.fromLastOccurrenceOf(":", false, false).getIntValue();
+        if (host.isEmpty() || port <= 0 || numConfiguredPeers >= maxPeers)
+            continue;
+
+        auto& peer = peers[(size_t) numConfiguredPeers++];
+        peer.active = true;
+        peer.host = host;
+        peer.address = resolveHost(host);
+        peer.port = port;
+        peer.hasTransportOffset = false;
+        peer.clock.reset();
+        peer.jitterBuffer.reset();
+    }
+
+    instanceId = (juce::uint32) juce::Random::getSystemRandom().nextInt() | 1u;
+    nextSequence = 0;
+    numRecentOnsets = 0;
+    repeatsLeft = 0;
+    lastSyncNs = 0;
+    for (auto& packet : delayedPackets)
+        packet.used = false;
+
+    resetStatistics();
+    running = true;
+    startThread(juce::Thread::Priority::high);
+    return true;
+}
+
+void NetworkEnsemble::stop()
+{
+    running = false;
+    if (socket != nullptr)
+        socket->shutdown();
+
+    stopThread(1000);
+    socket.reset();
+}
+
+void NetworkEnsemble::setImpairment(double latencyMs, double jitterMs, double lossRate)
+{
+    impairmentLatencyMs = juce::jmax(0.0, latencyMs);
+    impairmentJitterMs = juce::jlimit(0.0, juce::jmax(0.0, latencyMs), jitterMs);
+    impairmentLossRate = juce::jlimit(0.0, 1.0, lossRate);
+}
+
+//==============================================================================
+void NetworkEnsemble::sendOnset(int midiChannel, int onsetIndex, juce::int64 localTimeNs)
+{
+    if (!running.load(std::memory_order_relaxed))
+        return;
+
+    const auto scope = outboundFifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+    {
+        onsetsNotSent.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    scope.forEach([this, midiChannel, onsetIndex, localTimeNs](int index)
+        {
+            outbound[(size_t) index] = { midiChannel, onsetIndex, localTimeNs };
+        });
+}
+
+void NetworkEnsemble::addCorrectionLatency(double latencyMs)
+{
+    // Single writer (the audio thread), so load/store is enough
+    latencyCount.store(latencyCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    latencySumMs.store(latencySumMs.load(std::memory_order_relaxed) + latencyMs, std::memory_order_relaxed);
+    if (latencyMs > latencyMaxMs.load(std::memory_order_relaxed))
+        latencyMaxMs.store(latencyMs, std::memory_order_relaxed);
+}
+
+NetworkEnsemble::Statistics NetworkEnsemble::getStatistics() const
+{
+    Statistics statistics;
+    statistics.numPeers = numPeersHeard.load();
+    statistics.packetsSent = packetsSent.load();
+    statistics.packetsReceived = packetsReceived.load();
+    statistics.onsetsLost = onsetsLost.load() + lostInJitterBuffers.load();
+    statistics.onsetsLate = onsetsLate.load();
+    statistics.onsetsTimedOut = onsetsTimedOut.load();
+    statistics.onsetsNotSent = onsetsNotSent.load();
+    statistics.clockOffsetMs = clockOffsetMs.load();
+    statistics.clockDriftPpm = clockDriftPpm.load();
+    statistics.roundTripMs = roundTripMs.load();
+    statistics.playoutDelayMs = (double) playoutDelayNs.load() * 1.0e-6;
+    statistics.transportOffsetMs = transportOffsetMs.load();
+    statistics.hasTransportOffset = hasTransportOffset.load();
+    statistics.latencyCount = latencyCount.load();
+    statistics.meanLatencyMs = statistics.latencyCount > 0 ? latencySumMs.load() / (double) statistics.latencyCount : 0.0;
+    statistics.maxLatencyMs = latencyMaxMs.load();
+    return statistics;
+}
+
+void NetworkEnsemble::resetStatistics()
+{
+    packetsSent = 0;
+    packetsReceived = 0;
+    onsetsLost = 0;
+    lostInJitterBuffers = 0;
+    onsetsLate = 0;
+    onsetsTimedOut = 0;
+    onsetsNotSent = 0;
+    numPeersHeard = 0;
+    latencyCount = 0;
+    latencySumMs = 0.0;
+    latencyMaxMs = 0.0;
+}
+
+juce::int64 NetworkEnsemble::getTimeNs()
+{
+    static const juce::int64 ticksPerSecond = juce::Time::getHighResolutionTicksPerSecond();
+    auto ticks = juce::Time::getHighResolutionTicks();
+    return (ticks / ticksPerSecond) * 1000000000 + ((ticks % ticksPerSecond) * 1000000000) / ticksPerSecond;
+}
+
+//==============================================================================
+#pragma region Network Thread
+
+void NetworkEnsemble::run()
+{
+    while (!threadShouldExit())
+    {
+        socket->waitUntilReady(true, 1);
+
+        receivePackets();
+        sendPendingOnsets();
+        sendRepeats();
+        sendSyncRequests();
+        sendDelayedPackets();
+        deliverOnsets();
+    }
+}
+
+void NetworkEnsemble::receivePackets()
+{
+    std::array<juce::uint8, 512> buffer;
+    juce::String senderHost;
+    int senderPort = 0;
+
+    while (socket->waitUntilReady(true, 0) == 1)
+    {
+        int size = socket->read(buffer.data(), (int) buffer.size(), false, senderHost, senderPort);
+        if (size <= 0)
+            return;
+
+        packetsReceived.fetch_add(1, std::memory_order_relaxed);
+        handlePacket(buffer.data(), size, senderHost, senderPort);
+    }
+}
+
+void NetworkEnsemble::handlePacket(const juce::uint8* data, int size, const juce::String& senderHost, int senderPort)
+{
+    auto nowNs = getTimeNs();
+
+    PacketReader reader { data, size };
+    auto magic = reader.read<juce::uint32>();
+    auto version = reader.read<juce::uint8>();
+    auto type = reader.read<juce::uint8>();
+    auto count = reader.read<juce::uint16>();
+    auto senderId = reader.read<juce::uint32>();
+    if (!reader.isValid || magic != packetMagic || version != packetVersion || senderId == instanceId)
+        return;
+
+    int peerIndex = findPeer(senderId, senderHost, senderPort);
+    if (peerIndex < 0)
+        return;
+
+    auto& peer = peers[(size_t) peerIndex];
+
+    switch (type)
+    {
+    case syncRequestPacket:
+    {
+        auto t1 = reader.read<juce::int64>();
+        auto peerOriginNs = reader.read<juce::int64>();
+        if (!reader.isValid)
+            return;
+
+        // Both transports running: how far apart their score starts are
+        auto originNs = transportOriginNs.load(std::memory_order_relaxed);
+        peer.hasTransportOffset = peerOriginNs != 0 && originNs != 0 && peer.clock.isValid();
+        if (peer.hasTransportOffset)
+            peer.transportOffsetNs = peer.clock.toLocal(peerOriginNs) - originNs;
+
+        PacketWriter writer;
+        writer.write(packetMagic);
+        writer.write(packetVersion);
+        writer.write((juce::uint8) syncResponsePacket);
+        writer.write((juce::uint16) 0);
+        writer.write(instanceId);
+        writer.write(t1);
+        writer.write(nowNs);
+        writer.write(getTimeNs());
+        sendPacket(peerIndex, writer.data.data(), writer.size);
+        break;
+    }
+
+    case syncResponsePacket:
+    {
+        auto t1 = reader.read<juce::int64>();
+        auto t2 = reader.read<juce::int64>();
+        auto t3 = reader.read<juce::int64>();
+        if (!reader.isValid)
+            return;
+
+        peer.clock.addExchange(t1, t2, t3, nowNs);
+
+        if (peerIndex == 0)
+        {
+            clockOffsetMs = peer.clock.getOffsetNs(nowNs) * 1.0e-6;
+            clockDriftPpm = peer.clock.getDriftPpm();
+            roundTripMs = peer.clock.getRoundTripNs() * 1.0e-6;
+        }
+        break;
+    }
+
+    case onsetsPacket:
+    {
+        auto firstSequence = reader.read<juce::uint32>();
+        auto sentNs = reader.read<juce::int64>();
+
+        // Onsets cannot be placed on our clock until the first sync exchange has completed
+        if (!peer.clock.isValid())
+            return;
+
+        // Jitter is measured on the packet, as onset times can be ahead of when they were sent
+        auto transitNs = nowNs - peer.clock.toLocal(sentNs);
+
+        for (juce::uint32 i = 0; i < count; ++i)
+        {
+            NetworkOnset onset;
+            onset.onsetIndex = reader.read<juce::int32>();
+            onset.midiChannel = reader.read<juce::uint8>();
+            onset.timeNs = reader.read<juce::int64>();
+            if (!reader.isValid)
+                return;
+
+            peer.jitterBuffer.add(firstSequence + i, onset, nowNs, transitNs);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// The peer a packet came from: by id once known, else the peer at that address and port (a
+// configured one, or one that restarted with a new id), else a new peer that has us in its own list
+int NetworkEnsemble::findPeer(juce::uint32 id, const juce::String& host, int port)
+{
+    for (int i = 0; i < maxPeers; ++i)
+        if (peers[(size_t) i].active && peers[(size_t) i].id == id)
+            return i;
+
+    int index = -1;
+    for (int i = 0; i < maxPeers && index < 0; ++i)
+        if (peers[(size_t) i].active && peers[(size_t) i].port == port && peers[(size_t) i].address == host)
+            index = i;
+
+    for (int i = numConfiguredPeers; i < maxPeers && index < 0; ++i)
+    {
+        if (!peers[(size_t) i].active)
+        {
+            index = i;
+            peers[(size_t) i].active = true;
+            peers[(size_t) i].host = host;
+            peers[(size_t) i].address = host;
+            peers[(size_t) i].port = port;
+        }
+    }
+
+    if (index < 0)
+        return -1;
+
+    // A restarted instance keeps its slot, but has a new clock and starts its onsets from scratch
+    auto& peer = peers[(size_t) index];
+    if (peer.id == 0)
+        numPeersHeard.fetch_add(1);
+
+    peer.id = id;
+    peer.hasTransportOffset = false;
+    peer.clock.reset();
+    peer.jitterBuffer.reset();
+    return index;
+}
+
+// Each packet carries the newest onset and the ones before it, so a lost packet is repaired by the next
+void NetworkEnsemble::sendPendingOnsets()
+{
+    const auto scope = outboundFifo.read(outboundFifo.getNumReady());
+    scope.forEach([this](int index)
+        {
+            for (int i = redundancy - 1; i > 0; --i)
+                recentOnsets[(size_t) i] = recentOnsets[(size_t) i - 1];
+            recentOnsets[0] = outbound[(size_t) index];
+            numRecentOnsets = juce::jmin(numRecentOnsets + 1, redundancy);
+            ++nextSequence;
+
+            PacketWriter writer;
+            writer.write(packetMagic);
+            writer.write(packetVersion);
+            writer.write((juce::uint8) onsetsPacket);
+            writer.write((juce::uint16) numRecentOnsets);
+            writer.write(instanceId);
+            writer.write((juce::uint32) (nextSequence - (juce::uint32) numRecentOnsets));
+            writer.write(getTimeNs());
+
+            // Oldest first
+            for (int i = numRecentOnsets - 1; i >= 0; --i)
+            {
+                const auto& onset = recentOnsets[(size_t) i];
+                writer.write((juce::int32) onset.onsetIndex);
+                writer.write((juce::uint8) onset.midiChannel);
+                writer.write(onset.timeNs);
+            }
+
+            for (int peer = 0; peer < maxPeers; ++peer)
+                if (peers[(size_t) peer].active)
+                    sendPacket(peer, writer.data.data(), writer.size);
+
+            std::copy(writer.data.begin(), writer.data.begin() + writer.size, repeatPacket.begin());
+            repeatPacketSize = writer.size;
+            repeatsLeft = numRepeats;
+            nextRepeatNs = getTimeNs() + repeatIntervalNs;
+        });
+}
+
+// Onsets are far apart, so waiting for the next one to repair a loss would be too late
+void NetworkEnsemble::sendRepeats()
+{
+    if (repeatsLeft == 0 || getTimeNs() < nextRepeatNs)
+        return;
+
+    for (int peer = 0; peer < maxPeers; ++peer)
+        if (peers[(size_t) peer].active)
+            sendPacket(peer, repeatPacket.data(), repeatPacketSize);
+
+    --repeatsLeft;
+    nextRepeatNs += repeatIntervalNs;
+}
+
+void NetworkEnsemble::sendSyncRequests()
+{
+    auto nowNs = getTimeNs();
+    if (nowNs - lastSyncNs < syncIntervalNs)
+        return;
+
+    lastSyncNs = nowNs;
+
+    PacketWriter writer;
+    writer.write(packetMagic);
+    writer.write(packetVersion);
+    writer.write((juce::uint8) syncRequestPacket);
+    writer.write((juce::uint16) 0);
+    writer.write(instanceId);
+    writer.write(nowNs);
+    writer.write(transportOriginNs.load(std::memory_order_relaxed));
+
+    for (int peer = 0; peer < maxPeers; ++peer)
+        if (peers[(size_t) peer].active)
+            sendPacket(peer, writer.data.data(), writer.size);
+}
+
+// Hands in-order onsets to the audio thread, on our clock
+void NetworkEnsemble::deliverOnsets()
+{
+    auto nowNs = getTimeNs();
+    juce::int64 lost = 0, maxPlayoutDelay = 0, worstTransportOffset = 0;
+    bool anyTransportOffset = false;
+
+    for (auto& peer : peers)
+    {
+        if (!peer.active)
+            continue;
+
+        peer.jitterBuffer.popReady(nowNs, [this, &peer](const NetworkOnset& onset)
+            {
+                const auto scope = inboundFifo.write(1);
+                if (scope.blockSize1 + scope.blockSize2 == 0)
+                    onsetsLost.fetch_add(1, std::memory_order_relaxed);
+
+                scope.forEach([this, &peer, &onset](int index)
+                    {
+                        inbound[(size_t) index] = { onset.midiChannel, onset.onsetIndex, peer.clock.toLocal(onset.timeNs) };
+                    });
+            });
+
+        lost += peer.jitterBuffer.getNumLost();
+        maxPlayoutDelay = juce::jmax(maxPlayoutDelay, peer.jitterBuffer.getPlayoutDelayNs());
+
+        if (peer.hasTransportOffset && (!anyTransportOffset || std::abs(peer.transportOffsetNs) > std::abs(worstTransportOffset)))
+        {
+            worstTransportOffset = peer.transportOffsetNs;
+            anyTransportOffset = true;
+        }
+    }
+
+    playoutDelayNs = maxPlayoutDelay;
+    lostInJitterBuffers = lost;
+    transportOffsetMs = (double) worstTransportOffset * 1.0e-6;
+    hasTransportOffset = anyTransportOffset;
+}
+
+// Sends now, or later when an impairment is set
+void NetworkEnsemble::sendPacket(int peer, const juce::uint8* data, int size)
+{
+    const auto& destination = peers[(size_t) peer];
+    if (destination.port <= 0)
+        return;
+
+    if (random.nextDouble() < impairmentLossRate.load())
+        return;
+
+    double delayMs = impairmentLatencyMs.load() + impairmentJitterMs.load() * (2.0 * random.nextDouble() - 1.0);
+    if (delayMs > 0.0)
+    {
+        for (auto& packet : delayedPackets)
+        {
+            if (!packet.used && size <= (int) packet.data.size())
+            {
+                packet.used = true;
+                packet.dueNs = getTimeNs() + (juce::int64) (delayMs * 1.0e6);
+                packet.peer = peer;
+                packet.size = size;
+                std::copy(data, data + size, packet.data.begin());
+                return;
+            }
+        }
+    }
+
+    socket->write(destination.host, destination.port, data, size);
+    packetsSent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void NetworkEnsemble::sendDelayedPackets()
+{
+    auto nowNs = getTimeNs();
+    for (auto& packet : delayedPackets)
+    {
+        if (packet.used && packet.dueNs <= nowNs)
+        {
+            const auto& destination = peers[(size_t) packet.peer];
+            socket->write(destination.host, destination.port, packet.data.data(), packet.size);
+            packetsSent.fetch_add(1, std::memory_order_relaxed);
+            packet.used = false;
+        }
+    }
+}
+
+#pragma endregion Socket, clock sync and jitter buffers
+
+//==============================================================================
+#pragma region Loopback Check
+
+namespace
+{
+    // Host stand-in that reports a playing transport at the position set before each block
+    struct LoopbackPlayHead : public juce::AudioPlayHead
+    {
+        juce::Optional<PositionInfo> getPosition() const override { return info; }
+        PositionInfo info;
+    };
+}
+
+bool NetworkEnsemble::runLoopbackCheck(const juce::File& midiFile, const juce::Array<Player>& players,
+                                       double latencyMs, double jitterMs, double lossRate,
+                                       double seconds, juce::String& report)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int portA = 39100, portB = 39101;
+
+    // Every player is a computer player, owned by instance A (even indices) or B (odd indices)
+    juce::Array<Player> computerPlayers;
+    for (auto player : players)
+    {
+        player.setIsUser(false);
+        computerPlayers.add(player);
+    }
+
+    AdaptiveMetronomeAudioProcessor processorA, processorB;
+    for (auto* processor : { &processorA, &processorB })
+    {
+        processor->UpdatePlayers(computerPlayers);
+        processor->prepareToPlay(sampleRate, blockSize);
+        if (!processor->loadScore(midiFile))
+        {
+            report = "Could not load " + midiFile.getFileName();
+            return false;
+        }
+    }
+
+    if (!processorA.startNetwork(portA, { "127.0.0.1:" + juce::String(portB) }, 0xaau)
+        || !processorB.startNetwork(portB, { "127.0.0.1:" + juce::String(portA) }, 0x55u))
+    {
+        report = "Could not open loopback ports";
+        return false;
+    }
+
+    processorA.getNetwork().setImpairment(latencyMs, jitterMs, lossRate);
+    processorB.getNetwork().setImpairment(latencyMs, jitterMs, lossRate);
+
+    LoopbackPlayHead playHead;
+    playHead.info.setIsPlaying(true);
+    processorA.setPlayHead(&playHead);
+    processorB.setPlayHead(&playHead);
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(65536);
+
+    // Give the clocks a few exchanges before the performance starts, then run in real time
+    auto startMs = juce::Time::getMillisecondCounterHiRes() + 1000.0;
+    int numBlocks = (int) (seconds * sampleRate / blockSize);
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        auto dueMs = startMs + block * blockSize * 1000.0 / sampleRate;
+        while (juce::Time::getMillisecondCounterHiRes() < dueMs)
+            juce::Thread::sleep(1);
+
+        playHead.info.setTimeInSamples((juce::int64) block * blockSize);
+        for (auto* processor : { &processorA, &processorB })
+        {
+            buffer.clear();
+            midi.clear();
+            processor->processBlock(buffer, midi);
+        }
+    }
+
+    auto onsetsA = processorA.getAsynchronyStatistics().getSnapshot().numOnsets;
+    auto onsetsB = processorB.getAsynchronyStatistics().getSnapshot().numOnsets;
+    auto statisticsA = processorA.getNetwork().getStatistics();
+    auto statisticsB = processorB.getNetwork().getStatistics();
+
+    processorA.setPlayHead(nullptr);
+    processorB.setPlayHead(nullptr);
+    processorA.stopNetwork();
+    processorB.stopNetwork();
+
+    report = "Onsets " + juce::String(onsetsA) + " / " + juce::String(onsetsB);
+    for (const auto& statistics : { statisticsA, statisticsB })
+    {
+        report << "\nsent " << statistics.packetsSent << ", received " << statistics.packetsReceived
+               << ", lost " << statistics.onsetsLost << ", late " << statistics.onsetsLate
+               << ", timed out " << statistics.onsetsTimedOut << ", not sent " << statistics.onsetsNotSent
+               << ", offset " << juce::String(statistics.clockOffsetMs, 3) << " ms"
+               << ", round trip " << juce::String(statistics.roundTripMs, 2) << " ms"
+               << ", playout delay " << juce::String(statistics.playoutDelayMs, 2) << " ms"
+               << ", transport offset " << (statistics.hasTransportOffset ? juce::String(statistics.transportOffsetMs, 2) + " ms" : juce::String("unknown"))
+               << ", onset to correction " << juce::String(statistics.meanLatencyMs, 2)
+               << " ms mean, " << juce::String(statistics.maxLatencyMs, 2) << " ms max";
+    }
+
+    // Both halves should have stayed together, mostly on real rather than predicted onsets
+    auto maxTimeouts = juce::jmax((juce::int64) 2, juce::jmin(onsetsA, onsetsB) / 20);
+    // Both share one playhead, so their transports must also be found in step
+    auto inStep = [](const Statistics& statistics)
+        {
+            return statistics.hasTransportOffset && std::abs(statistics.transportOffsetMs) <= maxTransportOffsetMs;
+        };
+
+    return onsetsA > 0 && std::abs(onsetsA - onsetsB) <= 2
+           && statisticsA.onsetsTimedOut <= maxTimeouts && statisticsB.onsetsTimedOut <= maxTimeouts
+           && inStep(statisticsA) && inStep(statisticsB);
+}
+
+#pragma endregion Two processors over loopback
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "Player.h"
+
+// An onset of one player as exchanged between instances
+struct NetworkOnset
+{
+    int midiChannel = 0;        // Identifies the player - every instance uses the same channels
+    int onsetIndex = 0;         // Score onset it belongs to
+    juce::int64 timeNs = 0;     // Sender's clock on the wire, the receiver's clock once delivered
+};
+
+//==============================================================================
+// ClockEstimator - NTP-style estimate of a peer's clock relative to ours. Each request/response
+// exchange gives an offset sample and a round-trip delay. Offset and drift come from a straight
+// line fitted through the exchanges with the smallest delays in the recent window, as those are
+// the least disturbed by queueing.
+class ClockEstimator
+{
+public:
+    static constexpr int windowSize = 64;
+    static constexpr int numFitted = 16;
+
+    void reset()
+    {
+        count = 0;
+        next = 0;
+        fitOrigin = 0;
+        fitOffsetNs = 0.0;
+        fitDrift = 0.0;
+        minDelayNs = 0.0;
+    }
+
+    // t1 our request, t2 the peer receiving it, t3 the peer replying, t4 us receiving the reply
+    void addExchange(juce::int64 t1, juce::int64 t2, juce::int64 t3, juce::int64 t4)
+    {
+        double delay = (double) ((t4 - t1) - (t3 - t2));
+        if (delay < 0.0)
+            return;
+
+        samples[(size_t) next] = { t4, 0.5 * ((double) (t2 - t1) + (double) (t3 - t4)), delay };
+        next = (next + 1) % windowSize;
+        count = juce::jmin(count + 1, windowSize);
+        fit();
+    }
+
+    bool isValid() const { return count > 0; }
+
+    // Peer clock offset at the given local time (peer = local + offset)
+    double getOffsetNs(juce::int64 localNs) const { return fitOffsetNs + fitDrift * (double) (localNs - fitOrigin); }
+
+    juce::int64 toLocal(juce::int64 peerNs) const
+    {
+        // One fixed-point step is plenty with drift in parts per million
+        auto estimate = peerNs - (juce::int64) getOffsetNs(peerNs);
+        return peerNs - (juce::int64) getOffsetNs(estimate);
+    }
+
+    double getDriftPpm() const { return fitDrift * 1.0e6; }
+    double getRoundTripNs() const { return minDelayNs; }
+
+private:
+    struct Sample
+    {
+        juce::int64 localNs;
+        double offsetNs;
+        double delayNs;
+    };
+
+    void fit()
+    {
+        // The lowest-delay exchanges, by insertion into a small sorted array
+        std::array<const Sample*, numFitted> best {};
+        int numBest = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const auto* sample = &samples[(size_t) i];
+            int position = numBest;
+            while (position > 0 && best[(size_t) position - 1]->delayNs > sample->delayNs)
+                --position;
+
+            if (position >= numFitted)
+                continue;
+
+            for (int j = juce::jmin(numBest, numFitted - 1); j > position; --j)
+                best[(size_t) j] = best[(size_t) j - 1];
+            best[(size_t) position] = sample;
+            numBest = juce::jmin(numBest + 1, numFitted);
+        }
+
+        minDelayNs = best[0]->delayNs;
+        fitOrigin = best[0]->localNs;
+
+        // Least squares, in seconds from the origin to keep the sums well conditioned
+        double sumT = 0.0, sumO = 0.0, sumTT = 0.0, sumTO = 0.0;
+        double firstT = 0.0, lastT = 0.0;
+        for (int i = 0; i < numBest; ++i)
+        {
+            double t = (double) (best[(size_t) i]->localNs - fitOrigin) * 1.0e-9;
+            double o = best[(size_t) i]->offsetNs;
+            sumT += t;
+            sumO += o;
+            sumTT += t * t;
+            sumTO += t * o;
+            firstT = i == 0 ? t : juce::jmin(firstT, t);
+            lastT = i == 0 ? t : juce::jmax(lastT, t);
+        }
+
+        double meanT = sumT / numBest;
+        double meanO = sumO / numBest;
+        double varianceT = sumTT / numBest - meanT * meanT;
+
+        // Drift needs the fitted exchanges to span a few seconds before it means anything
+        double driftPerSecond = 0.0;
+        if (numBest >= 4 && lastT - firstT >= minDriftSpanSeconds && varianceT > 0.0)
+            driftPerSecond = juce::jlimit(-maxDrift * 1.0e9, maxDrift * 1.0e9, (sumTO / numBest - meanT * meanO) / varianceT);
+
+        fitDrift = driftPerSecond * 1.0e-9;
+        fitOffsetNs = meanO - driftPerSecond * meanT;
+    }
+
+    static constexpr double minDriftSpanSeconds = 2.0;
+    static constexpr double maxDrift = 500.0e-6;
+
+    std::array<Sample, windowSize> samples {};
+    int count = 0;
+    int next = 0;
+
+    juce::int64 fitOrigin = 0;
+    double fitOffsetNs = 0.0;
+    double fitDrift = 0.0;          // ns of offset per ns of local time
+    double minDelayNs = 0.0;
+};
+
+//==============================================================================
+// JitterBuffer - puts one peer's onsets back into sequence order. Every packet is sent a few
+// times and repeats the sender's last few onsets, so a lost packet is usually repaired. A gap still
+// open when its playout deadline passes is given up as lost; the deadline follows the measured
+// transit jitter (the RFC 3550 estimator).
+class JitterBuffer
+{
+public:
+    static constexpr int capacity = 64;
+
+    void reset()
+    {
+        for (auto& slot : slots)
+            slot.filled = false;
+        started = false;
+        nextSequence = 0;
+        jitterNs = 0.0;
+        hasTransit = false;
+        numLost = 0;
+    }
+
+    // transitNs is the arrival time less the send time, both on the local clock
+    void add(juce::uint32 sequence, const NetworkOnset& onset, juce::int64 arrivalNs, juce::int64 transitNs)
+    {
+        if (!started)
+        {
+            started = true;
+            nextSequence = sequence;
+        }
+
+        auto ahead = (juce::int32) (sequence - nextSequence);
+        if (ahead < 0)
+            return;     // Already delivered or given up - usually a redundant copy
+
+        // So far ahead that the window has to jump; whatever was waiting in it is dropped
+        if (ahead >= capacity)
+        {
+            numLost += ahead - (capacity - 1);
+            for (auto& slot : slots)
+                slot.filled = false;
+            nextSequence = sequence - (capacity - 1);
+        }
+
+        auto& slot = slots[(size_t) (sequence % capacity)];
+        if (slot.filled && slot.sequence == sequence)
+            return;
+
+        slot = { true, sequence, onset, arrivalNs };
+
+        if (hasTransit)
+            jitterNs += (std::abs((double) (transitNs - previousTransitNs)) - jitterNs) / 16.0;
+        previousTransitNs = transitNs;
+        hasTransit = true;
+    }
+
+    // Calls deliver(const NetworkOnset&) for every onset that is now in order
+    template <typename Callback>
+    void popReady(juce::int64 nowNs, Callback&& deliver)
+    {
+        while (started)
+        {
+            auto& slot = slots[(size_t) (nextSequence % capacity)];
+            if (slot.filled && slot.sequence == nextSequence)
+            {
+                deliver(slot.onset);
+                slot.filled = false;
+                ++nextSequence;
+                continue;
+            }
+
+            // A gap: wait for it until the playout deadline of the oldest onset behind it
+            juce::int64 oldestArrival = 0;
+            bool anyWaiting = false;
+            for (const auto& waiting : slots)
+            {
+                if (waiting.filled && (!anyWaiting || waiting.arrivalNs < oldestArrival))
+                {
+                    oldestArrival = waiting.arrivalNs;
+                    anyWaiting = true;
+                }
+            }
+
+            if (!anyWaiting || nowNs < oldestArrival + getPlayoutDelayNs())
+                return;
+
+            skip();
+            ++numLost;
+        }
+    }
+
+    juce::int64 getPlayoutDelayNs() const { return minPlayoutDelayNs + (juce::int64) (4.0 * jitterNs); }
+    int getNumLost() const { return numLost; }
+
+private:
+    void skip()
+    {
+        auto& slot = slots[(size_t) (nextSequence % capacity)];
+        if (slot.sequence == nextSequence)
+            slot.filled = false;
+        ++nextSequence;
+    }
+
+    struct Slot
+    {
+        bool filled = false;
+        juce::uint32 sequence = 0;
+        NetworkOnset onset;
+        juce::int64 arrivalNs = 0;
+    };
+
+    static constexpr juce::int64 minPlayoutDelayNs = 2000000;
+
+    std::array<Slot, capacity> slots {};
+    bool started = false;
+    juce::uint32 nextSequence = 0;
+    double jitterNs = 0.0;
+    juce::int64 previousTransitNs = 0;
+    bool hasTransit = false;
+    int numLost = 0;
+};
+
+//==============================================================================
+// SampleClock - maps the host's sample positions to the local clock. Block callbacks arrive
+// with some jitter, so the offset between the two is smoothed; a transport jump restarts it.
+class SampleClock
+{
+public:
+    void reset() { isValid = false; }
+
+    void update(juce::int64 blockStartSample, double newSampleRate, juce::int64 nowNs)
+    {
+        double measured = (double) nowNs - (double) blockStartSample * 1.0e9 / newSampleRate;
+        if (!isValid || newSampleRate != sampleRate)
+        {
+            sampleRate = newSampleRate;
+            offsetNs = measured;
+            isValid = true;
+            return;
+        }
+
+        offsetNs += smoothing * (measured - offsetNs);
+    }
+
+    juce::int64 sampleToNs(double sample) const { return (juce::int64) (offsetNs + sample * 1.0e9 / sampleRate); }
+    double nsToSample(juce::int64 ns) const { return ((double) ns - offsetNs) * sampleRate * 1.0e-9; }
+
+private:
+    static constexpr double smoothing = 0.01;
+
+    bool isValid = false;
+    double sampleRate = 44100.0;
+    double offsetNs = 0.0;      // Local clock at sample 0
+};
+
+//==============================================================================
+// NetworkEnsemble - joins instances on several machines, one per musician, into one ensemble
+// over UDP. Each instance plays its local players and sends their onsets to every peer; the
+// players of other instances are user players in the local model, fed with the peers' onsets.
+//
+// A network thread owns the socket. It keeps a ClockEstimator and JitterBuffer per peer, and
+// swaps onsets with the audio thread through two fixed single-producer/single-consumer queues,
+// so the audio thread never blocks or allocates. Delivered onsets carry local clock times; the
+// processor turns them into sample time with its SampleClock.
+//
+// Remote onsets are placed by wall-clock time, so the hosts' transports have to play the score in
+// step: each must reach the same score position at the same moment (start together, from a shared
+// sync such as MIDI Time Code or Ableton Link). Every instance sends where its transport's score
+// start lies on its clock with the sync requests, and each peer's difference from ours is measured;
+// getStatistics().transportOffsetMs beyond maxTransportOffsetMs means the hosts are not in step and
+// the remote players will be heard early or late, or time out.
+//
+// setImpairment() adds artificial latency, jitter and loss to everything sent, for testing over
+// loopback - see runLoopbackCheck().
+class NetworkEnsemble : private juce::Thread
+{
+public:
+    static constexpr int maxPeers = 7;
+    static constexpr int defaultPort = 9100;
+    static constexpr double maxTransportOffsetMs = 20.0;
+
+    struct Statistics
+    {
+        int numPeers = 0;               // Peers heard from
+        juce::int64 packetsSent = 0;
+        juce::int64 packetsReceived = 0;
+        juce::int64 onsetsLost = 0;     // Never arrived, even as a redundant copy
+        juce::int64 onsetsLate = 0;     // Arrived after the model moved on
+        juce::int64 onsetsTimedOut = 0; // Waited for, then replaced by the model's prediction
+        juce::int64 onsetsNotSent = 0;  // Dropped because the queue to the network thread was full
+        double clockOffsetMs = 0.0;     // First peer
+        double clockDriftPpm = 0.0;
+        double roundTripMs = 0.0;
+        double playoutDelayMs = 0.0;
+        double transportOffsetMs = 0.0; // Peer whose transport is furthest from ours; positive when it is behind
+        bool hasTransportOffset = false;    // Some peer's transport is running at the same time as ours
+        juce::int64 latencyCount = 0;   // Remote onset to the local correction that used it
+        double meanLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+    };
+
+    NetworkEnsemble();
+    ~NetworkEnsemble() override;
+
+    // Message thread. Peers are "host:port"
+    bool start(int localPort, const juce::StringArray& peerAddresses);
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // Applied to every packet sent from now on
+    void setImpairment(double latencyMs, double jitterMs, double lossRate);
+
+    //==============================================================================
+    // Audio thread
+    void sendOnset(int midiChannel, int onsetIndex, juce::int64 localTimeNs);
+
+    // Local clock time of the score's start at the transport's current position, or 0 while stopped
+    void setTransportOrigin(juce::int64 localTimeNs) { transportOriginNs.store(localTimeNs, std::memory_order_relaxed); }
+
+    // Calls callback(const NetworkOnset&) for each remote onset delivered since the last call
+    template <typename Callback>
+    void popOnsets(Callback&& callback)
+    {
+        const auto scope = inboundFifo.read(inboundFifo.getNumReady());
+        scope.forEach([this, &callback](int index) { callback(inbound[(size_t) index]); });
+    }
+
+    juce::int64 getPlayoutDelayNs() const { return playoutDelayNs.load(std::memory_order_relaxed); }
+    void addCorrectionLatency(double latencyMs);
+    void addLateOnset() { onsetsLate.fetch_add(1, std::memory_order_relaxed); }
+    void addTimedOutOnset() { onsetsTimedOut.fetch_add(1, std::memory_order_relaxed); }
+
+    //==============================================================================
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+    static juce::int64 getTimeNs();
+
+    // Runs two processors against each other over loopback in real time, each owning half of
+    // the players, with the given impairment on both directions. Blocks for the given time
+    static bool runLoopbackCheck(const juce::File& midiFile, const juce::Array<Player>& players,
+                                 double latencyMs, double jitterMs, double lossRate,
+                                 double seconds, juce::String& report);
+
+private:
+    void run() override;
+
+    struct Peer
+    {
+        bool active = false;
+        juce::uint32 id = 0;
+        juce::String host;
+        juce::String address;           // The host resolved to the numeric address its packets come from
+        int port = 0;
+        juce::int64 transportOffsetNs = 0;  // Its score start less ours, on our clock
+        bool hasTransportOffset = false;
+        ClockEstimator clock;
+        JitterBuffer jitterBuffer;
+    };
+
+    struct DelayedPacket
+    {
+        bool used = false;
+        juce::int64 dueNs = 0;
+        int peer = 0;
+        int size = 0;
+        std::array<juce::uint8, 128> data {};
+    };
+
+    static constexpr int queueSize = 256;
+    static constexpr int redundancy = 4;                // Onsets carried by each packet
+    static constexpr int numRepeats = 2;                // Extra copies of each onset packet...
+    static constexpr juce::int64 repeatIntervalNs = 5000000;   // ...this far apart, so one loss burst rarely takes them all
+    static constexpr juce::int64 syncIntervalNs = 200000000;
+
+    void receivePackets();
+    void handlePacket(const juce::uint8* data, int size, const juce::String& senderHost, int senderPort);
+    void sendPendingOnsets();
+    void sendRepeats();
+    void sendSyncRequests();
+    void deliverOnsets();
+    void sendPacket(int peer, const juce::uint8* data, int size);
+    void sendDelayedPackets();
+    int findPeer(juce::uint32 id, const juce::String& host, int port);
+
+    std::unique_ptr<juce::DatagramSocket> socket;
+    std::array<Peer, maxPeers> peers;
+    int numConfiguredPeers = 0;
+    juce::uint32 instanceId = 0;
+
+    // Audio thread -> network thread
+    juce::AbstractFifo outboundFifo { queueSize };
+    std::array<NetworkOnset, queueSize> outbound {};
+    // Network thread -> audio thread
+    juce::AbstractFifo inboundFifo { queueSize };
+    std::array<NetworkOnset, queueSize> inbound {};
+
+    // Network thread only
+    juce::uint32 nextSequence = 0;
+    std::array<NetworkOnset, redundancy> recentOnsets {};
+    int numRecentOnsets = 0;
+    std::array<juce::uint8, 128> repeatPacket {};
+    int repeatPacketSize = 0;
+    int repeatsLeft = 0;
+    juce::int64 nextRepeatNs = 0;
+    juce::int64 lastSyncNs = 0;
+    std::array<DelayedPacket, queueSize> delayedPackets {};
+    juce::Random random;
+
+    std::atomic<bool> running { false };
+    std::atomic<double> impairmentLatencyMs { 0.0 }, impairmentJitterMs { 0.0 }, impairmentLossRate { 0.0 };
+    std::atomic<juce::int64> playoutDelayNs { 0 };
+    std::atomic<juce::int64> transportOriginNs { 0 };       // Set by the audio thread
+    std::atomic<double> transportOffsetMs { 0.0 };
+    std::atomic<bool> hasTransportOffset { false };
+    std::atomic<juce::int64> lostInJitterBuffers { 0 };     // Published by the network thread
+
+    std::atomic<juce::int64> packetsSent { 0 }, packetsReceived { 0 }, onsetsLost { 0 }, onsetsLate { 0 }, onsetsTimedOut { 0 };
+    std::atomic<juce::int64> onsetsNotSent { 0 };           // Written by the audio thread
+    std::atomic<int> numPeersHeard { 0 };
+    std::atomic<double> clockOffsetMs { 0.0 }, clockDriftPpm { 0.0 }, roundTripMs { 0.0 };
+    std::atomic<juce::int64> latencyCount { 0 };
+    std::atomic<double> latencySumMs { 0.0 }, latencyMaxMs { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NetworkEnsemble)
+};
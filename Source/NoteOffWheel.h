@@ -0,0 +1,140 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <limits>
+#include <vector>
+
+//==============================================================================
+// NoteOffWheel - pending note-offs for the computer players, kept in a hashed timing wheel.
+// Each slot covers slotSamples samples and holds an intrusive list of entries taken from a
+// pool allocated in prepare(), so adding a note-off and emitting it are both constant time
+// and nothing is allocated on the audio thread. Note-offs further away than one turn of the
+// wheel simply stay in their slot until their time comes round.
+class NoteOffWheel
+{
+public:
+    static constexpr int slotSamples = 32;
+    static constexpr int numSlots = 4096;   // Power of two - about 2.7 s per turn at 48 kHz
+
+    // Allocates the entry pool. Message thread only
+    void prepare(int capacity)
+    {
+        pool.assign((size_t) capacity, {});
+        slots.fill(-1);
+        soundingCounts.fill(0);
+
+        freeList = -1;
+        for (int i = capacity - 1; i >= 0; --i)
+        {
+            pool[(size_t) i].next = freeList;
+            freeList = i;
+        }
+
+        numPending = 0;
+        currentSlot = 0;
+    }
+
+    // Schedules a note-off. Returns false if the pool is exhausted, in which case the caller
+    // should end the note straight away
+    bool add(juce::int64 time, int channel, int noteNumber)
+    {
+        if (freeList < 0)
+        {
+            jassertfalse; // More overlapping notes than prepare() allowed for
+            return false;
+        }
+
+        int index = freeList;
+        auto& entry = pool[(size_t) index];
+        freeList = entry.next;
+
+        entry.time = time;
+        entry.channel = (juce::uint8) channel;
+        entry.noteNumber = (juce::uint8) noteNumber;
+
+        // Anything already due goes in the slot being processed so it is emitted next block
+        juce::int64 slot = juce::jmax(time / slotSamples, currentSlot);
+        auto& head = slots[(size_t) (slot & (numSlots - 1))];
+        entry.next = head;
+        head = index;
+
+        ++soundingCounts[getNoteIndex(channel, noteNumber)];
+        ++numPending;
+        return true;
+    }
+
+    // Emits every note-off due before blockEnd as emit(time, channel, noteNumber).
+    // A note retriggered while still sounding is only released by its last note-off
+    template <typename Callback>
+    void advance(juce::int64 blockEnd, Callback&& emit)
+    {
+        juce::int64 lastSlot = (blockEnd - 1) / slotSamples;
+        if (numPending == 0)
+        {
+            currentSlot = juce::jmax(currentSlot, lastSlot);
+            return;
+        }
+
+        // After a long gap one full turn of the wheel visits every slot
+        juce::int64 firstSlot = juce::jmax(currentSlot, lastSlot - numSlots + 1);
+        for (juce::int64 slot = firstSlot; slot <= lastSlot; ++slot)
+        {
+            int* link = &slots[(size_t) (slot & (numSlots - 1))];
+            while (*link >= 0)
+            {
+                auto& entry = pool[(size_t) *link];
+                if (entry.time >= blockEnd)
+                {
+                    link = &entry.next;
+                    continue;
+                }
+
+                if (--soundingCounts[getNoteIndex(entry.channel, entry.noteNumber)] == 0)
+                    emit(entry.time, (int) entry.channel, (int) entry.noteNumber);
+
+                int index = *link;
+                *link = entry.next;
+                entry.next = freeList;
+                freeList = index;
+                --numPending;
+            }
+        }
+
+        currentSlot = lastSlot;
+    }
+
+    // Releases every pending note now, e.g. when the transport stops or jumps
+    template <typename Callback>
+    void flush(Callback&& emit)
+    {
+        if (numPending > 0)
+            advance(std::numeric_limits<juce::int64>::max(), [&emit](juce::int64, int channel, int noteNumber) { emit(channel, noteNumber); });
+
+        currentSlot = 0;
+    }
+
+    // Restarts the wheel at a new position without emitting anything
+    void setPosition(juce::int64 time) { jassert(numPending == 0); currentSlot = time / slotSamples; }
+
+    int getNumPending() const { return numPending; }
+    int getCapacity() const { return (int) pool.size(); }
+
+private:
+    struct Entry
+    {
+        juce::int64 time = 0;
+        int next = -1;
+        juce::uint8 channel = 0;
+        juce::uint8 noteNumber = 0;
+    };
+
+    static size_t getNoteIndex(int channel, int noteNumber) { return (size_t) (((channel - 1) & 15) * 128 + (noteNumber & 127)); }
+
+    std::vector<Entry> pool;
+    std::array<int, numSlots> slots;
+    std::array<juce::uint16, 16 * 128> soundingCounts;
+    int freeList = -1;
+    int numPending = 0;
+    juce::int64 currentSlot = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// One score onset as the ensemble played it, for display
+struct OnsetRecord
+{
+    static constexpr int maxPlayers = 4;
+
+    int onsetIndex = 0;
+    int numPlayers = 0;
+    juce::uint32 playedMask = 0;        // Bit per player with notes at this onset
+    bool followsRelocation = false;     // First onset after a transport jump
+
+    // Each player's onset relative to the mean of the players that played, in ms (negative = leading)
+    std::array<float, maxPlayers> asynchronyMs {};
+
+    // Corrections the model applied to player i because of player j, in ms - alpha or beta times their asynchrony
+    std::array<std::array<float, maxPlayers>, maxPlayers> phaseCorrectionMs {};
+    std::array<std::array<float, maxPlayers>, maxPlayers> periodCorrectionMs {};
+};
+
+//==============================================================================
+// OnsetFifo - hands onset records from the audio thread (single producer) to the editor
+// (single consumer) without locking. The capacity is fixed, so when nobody is reading, new
+// records are dropped instead of the audio thread ever waiting or allocating.
+class OnsetFifo
+{
+public:
+    static constexpr int capacity = 1024;
+
+    OnsetFifo() = default;
+
+    // Audio thread
+    bool push(const OnsetRecord& record)
+    {
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+        {
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        scope.forEach([this, &record](int index) { records[(size_t) index] = record; });
+        return true;
+    }
+
+    // Message thread. Calls callback(const OnsetRecord&) for everything queued, oldest first
+    template <typename Callback>
+    int popAll(Callback&& callback)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([this, &callback](int index) { callback(records[(size_t) index]); });
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<OnsetRecord, capacity> records;
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetFifo)
+};
@@ -0,0 +1,187 @@
+#include "OscInput.h"
+#include "NetworkEnsemble.h"
+
+OscInput::OscInput()
+{
+    receiver.addListener(this);
+}
+
+OscInput::~OscInput()
+{
+    stop();
+    receiver.removeListener(this);
+}
+
+bool OscInput::start(int port)
+{
+    stop();
+
+    if (!receiver.connect(port))
+    {
+        DBG("Could not open OSC port " + juce::String(port));
+        return false;
+    }
+
+    currentPort = port;
+    hasWallClockOffset = false;
+    numReceived = 0;
+    numDropped = 0;
+    numIgnored = 0;
+    running = true;
+    return true;
+}
+
+void OscInput::stop()
+{
+    running = false;
+    receiver.disconnect();
+    currentPort = 0;
+}
+
+//==============================================================================
+#pragma region Receiver Thread
+
+void OscInput::oscMessageReceived(const juce::OSCMessage& message)
+{
+    handleMessage(message, NetworkEnsemble::getTimeNs());
+}
+
+void OscInput::oscBundleReceived(const juce::OSCBundle& bundle)
+{
+    handleBundle(bundle, NetworkEnsemble::getTimeNs());
+}
+
+void OscInput::handleBundle(const juce::OSCBundle& bundle, juce::int64 arrivalNs)
+{
+    auto timeNs = timeTagToLocalNs(bundle.getTimeTag(), arrivalNs);
+
+    for (const auto& element : bundle)
+    {
+        if (element.isMessage())
+            handleMessage(element.getMessage(), timeNs);
+        else if (element.isBundle())
+            handleBundle(element.getBundle(), arrivalNs);
+    }
+}
+
+void OscInput::handleMessage(const juce::OSCMessage& message, juce::int64 timeNs)
+{
+    if (message.getAddressPattern().toString() != tapAddress || message.isEmpty()
+        || !(message[0].isInt32() || message[0].isFloat32()))
+    {
+        numIgnored.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int channel = message[0].isInt32() ? message[0].getInt32() : juce::roundToInt(message[0].getFloat32());
+    if (channel < 1 || channel > 16)
+    {
+        numIgnored.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    numReceived.fetch_add(1, std::memory_order_relaxed);
+
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    scope.forEach([this, channel, timeNs](int index) { taps[(size_t) index] = { channel, timeNs }; });
+}
+
+// The bundle's time on our clock, or its arrival when the tag is "immediately" or implausibly far away
+juce::int64 OscInput::timeTagToLocalNs(const juce::OSCTimeTag& timeTag, juce::int64 arrivalNs)
+{
+    if (timeTag.isImmediately())
+        return arrivalNs;
+
+    double wallNs = (double) juce::Time::currentTimeMillis() * 1.0e6;
+    double offsetNs = wallNs - (double) arrivalNs;
+    wallClockOffsetNs = hasWallClockOffset ? wallClockOffsetNs + 0.01 * (offsetNs - wallClockOffsetNs) : offsetNs;
+    hasWallClockOffset = true;
+
+    // NTP format: seconds since 1900 in the upper 32 bits, the fraction in the lower
+    constexpr juce::uint64 secondsFrom1900To1970 = 2208988800ull;
+    auto raw = timeTag.getRawTimeTag();
+    double seconds = (double) ((raw >> 32) - secondsFrom1900To1970) + (double) (raw & 0xffffffffull) / 4294967296.0;
+    auto tagNs = (juce::int64) (seconds * 1.0e9 - wallClockOffsetNs);
+
+    return std::abs(tagNs - arrivalNs) <= maxTimeTagDistanceNs ? tagNs : arrivalNs;
+}
+
+#pragma endregion OSC parsing and the queue to the audio thread
+
+//==============================================================================
+bool OscInput::runLoopbackCheck(int numTaps, juce::String& report)
+{
+    constexpr int port = 39200;
+
+    OscInput input;
+    if (!input.start(port))
+    {
+        report = "Could not open OSC port " + juce::String(port);
+        return false;
+    }
+
+    juce::OSCSender sender;
+    if (!sender.connect("127.0.0.1", port))
+    {
+        report = "Could not connect the OSC sender";
+        return false;
+    }
+
+    // The reader stands in for the audio thread, draining the queue every millisecond
+    std::atomic<bool> sending { true }, finished { false };
+    int numPopped = 0, numOutOfOrder = 0;
+    juce::int64 maxLatencyNs = 0;
+
+    juce::Thread::launch([&]
+        {
+            juce::int64 previousNs = 0;
+            auto drain = [&]
+                {
+                    input.popTaps([&](const ExternalTap& tap)
+                        {
+                            if (tap.timeNs < previousNs)
+                                ++numOutOfOrder;
+                            previousNs = tap.timeNs;
+                            maxLatencyNs = juce::jmax(maxLatencyNs, NetworkEnsemble::getTimeNs() - tap.timeNs);
+                            ++numPopped;
+                        });
+                };
+
+            // Keeps going a little after the sender stops, for whatever is still in flight
+            auto stopMs = 0.0;
+            while (sending.load() || juce::Time::getMillisecondCounterHiRes() < stopMs)
+            {
+                if (sending.load())
+                    stopMs = juce::Time::getMillisecondCounterHiRes() + 200.0;
+
+                drain();
+                juce::Thread::sleep(1);
+            }
+
+            finished = true;
+        });
+
+    auto startMs = juce::Time::getMillisecondCounterHiRes();
+    for (int i = 0; i < numTaps; ++i)
+        sender.send(tapAddress, 1 + i % 4);
+    auto sendMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+
+    sending = false;
+    while (!finished.load())
+        juce::Thread::sleep(10);
+
+    input.stop();
+
+    report = juce::String(numTaps) + " taps sent in " + juce::String(sendMs, 1) + " ms, "
+             + juce::String(numPopped) + " delivered, " + juce::String(input.getNumDropped()) + " dropped by the queue, "
+             + juce::String(numOutOfOrder) + " out of order, max latency " + juce::String((double) maxLatencyNs * 1.0e-6, 2) + " ms";
+
+    // UDP can lose packets under a burst, but nothing delivered may be out of order or counted twice
+    return numPopped > 0 && numOutOfOrder == 0 && numPopped + input.getNumDropped() <= numTaps;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// A tap from an external device, on the local clock (NetworkEnsemble::getTimeNs)
+struct ExternalTap
+{
+    int midiChannel = 0;        // The user player it belongs to, as with MIDI taps
+    juce::int64 timeNs = 0;
+};
+
+//==============================================================================
+// OscInput - receives taps from OSC tapping devices and hands them to the audio thread.
+//
+// A tap is "/metronome/tap" with the player's MIDI channel as an int (an optional second
+// argument, such as a velocity, is ignored). A tap sent inside a bundle is placed at the
+// bundle's time tag when that is within a second of now, so a device that stamps its own taps
+// is not affected by network delay; otherwise it is placed at its arrival.
+//
+// Messages are parsed on the OSC receiver thread and pushed through a fixed single-producer/
+// single-consumer queue. When the audio thread falls behind, taps are dropped and counted
+// rather than anything waiting. Taps that arrive while the ensemble is not playing are thrown
+// away and counted as ignored, as MIDI taps then are.
+class OscInput : private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+{
+public:
+    static constexpr int defaultPort = 9001;
+    static constexpr int queueSize = 1024;
+    static constexpr const char* tapAddress = "/metronome/tap";
+
+    OscInput();
+    ~OscInput() override;
+
+    // Message thread
+    bool start(int port);
+    void stop();
+    bool isRunning() const { return running.load(); }
+    int getPort() const { return currentPort; }
+
+    // Audio thread. Calls callback(const ExternalTap&) for each tap received since the last call
+    template <typename Callback>
+    void popTaps(Callback&& callback)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        scope.forEach([this, &callback](int index) { callback(taps[(size_t) index]); });
+    }
+
+    // Audio thread. Throws the queued taps away while the transport is stopped or calibrating
+    void discardTaps()
+    {
+        auto numReady = fifo.getNumReady();
+        fifo.finishedRead(numReady);
+        numIgnored.fetch_add(numReady, std::memory_order_relaxed);
+    }
+
+    // Audio thread. A tap taken from the queue that could not be held, or that was from before a relocation
+    void addDroppedTap() { numDropped.fetch_add(1, std::memory_order_relaxed); }
+    void addIgnoredTap() { numIgnored.fetch_add(1, std::memory_order_relaxed); }
+
+    juce::int64 getNumReceived() const { return numReceived.load(std::memory_order_relaxed); }
+    juce::int64 getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+    juce::int64 getNumIgnored() const { return numIgnored.load(std::memory_order_relaxed); }
+
+    // Sends a burst of taps from a local OSCSender as fast as it can and checks they all come out
+    // of the queue in order. Blocks until done
+    static bool runLoopbackCheck(int numTaps, juce::String& report);
+
+private:
+    void oscMessageReceived(const juce::OSCMessage& message) override;
+    void oscBundleReceived(const juce::OSCBundle& bundle) override;
+    void handleBundle(const juce::OSCBundle& bundle, juce::int64 arrivalNs);
+    void handleMessage(const juce::OSCMessage& message, juce::int64 timeNs);
+    juce::int64 timeTagToLocalNs(const juce::OSCTimeTag& timeTag, juce::int64 arrivalNs);
+
+    static constexpr juce::int64 maxTimeTagDistanceNs = 1000000000;
+
+    juce::OSCReceiver receiver { "OSC Input" };
+    int currentPort = 0;
+
+    juce::AbstractFifo fifo { queueSize };
+    std::array<ExternalTap, queueSize> taps {};
+
+    // Receiver thread only. Wall clock less local clock, smoothed over the millisecond steps of the wall clock
+    double wallClockOffsetNs = 0.0;
+    bool hasWallClockOffset = false;
+
+    std::atomic<bool> running { false };
+    std::atomic<juce::int64> numReceived { 0 }, numDropped { 0 }, numIgnored { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscInput)
+};
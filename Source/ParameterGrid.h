@@ -0,0 +1,502 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "TraceLog.h"
+
+// PlayerParameter Structure for handling retrieval of parameters
+struct PlayerParameters
+{
+    bool isUser;
+    int id;
+    int midiChannel;
+    double volume;
+    double delay;
+    double motorNoiseSTD;
+    double timeKeeperNoiseSTD;
+};
+
+struct PlayerAlphaAndBeta
+{
+    double alphas[4]; // Array for alpha values
+    double betas[4];  // Array for beta values
+};
+
+//==============================================================================
+// ParameterGrid - the player parameter table and the alpha/beta coupling matrix in a single
+// component that draws and hit-tests every cell itself. Values live in one flat array and a
+// cell is just an index into it, so the grid owns no per-cell components or allocations.
+//
+// Everything that does not depend on the values (panels, headings, knob tracks, text boxes) is
+// rendered into a cached image when the grid is resized or the number of user players changes.
+// Changing a value repaints only that cell.
+class ParameterGrid : public juce::Component
+{
+public:
+    static constexpr int maxPlayers = 4;
+
+    ParameterGrid()
+    {
+        setOpaque(true);
+
+        // Each player starts on its own MIDI channel, every knob at its minimum
+        for (int row = 0; row < maxPlayers; ++row)
+            values[(size_t) getPlayerCell(row, channelColumn)] = row + 1;
+
+        addChildComponent(valueEditor);
+        valueEditor.setJustification(juce::Justification::centred);
+        valueEditor.onReturnKey = [this] { commitTextEdit(); };
+        valueEditor.onFocusLost = [this] { commitTextEdit(); };
+        valueEditor.onEscapeKey = [this] { hideTextEditor(); };
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        TraceLog::ScopedTrace trace("parameter grid paint", "gui");
+
+        auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+        if (!background.isValid() || backgroundScale != scale)
+            renderBackground(scale);
+
+        g.drawImage(background, getLocalBounds().toFloat());
+
+        // Only the cells inside the area being repainted
+        auto clip = g.getClipBounds();
+        for (int cell = 0; cell < numCells; ++cell)
+            if (isCellVisible(cell) && cellBounds[(size_t) cell].intersects(clip))
+                drawCellValue(g, cell);
+    }
+
+    void resized() override
+    {
+        auto bounds = getLocalBounds();
+        playersArea = bounds.removeFromLeft(bounds.getWidth() / 2);
+        couplingArea = bounds;
+
+#pragma region Player Table
+        auto area = playersArea.reduced(10);
+        playerCellHeight = area.getHeight() / (maxPlayers + 1); // Players + header
+        playerColumnWidth = area.getWidth() / 6;
+        playerTableOrigin = area.getPosition();
+
+        for (int row = 0; row < maxPlayers; ++row)
+        {
+            int y = playerTableOrigin.y + (row + 1) * playerCellHeight;
+
+            cellBounds[(size_t) getPlayerCell(row, channelColumn)] = { playerTableOrigin.x + playerColumnWidth + playerColumnWidth / 8, y + playerCellHeight / 4,
+                                                                       playerColumnWidth * 3 / 4, playerCellHeight / 2 };
+
+            for (int column = volumeColumn; column < numPlayerColumns; ++column)
+                cellBounds[(size_t) getPlayerCell(row, column)] = { playerTableOrigin.x + (column + 1) * playerColumnWidth, y, playerColumnWidth, playerCellHeight };
+        }
+#pragma endregion Positions of the channel boxes and knobs in the player table
+
+#pragma region Coupling Matrix
+        area = couplingArea.reduced(10);
+        couplingTitleHeight = 40;
+        area.removeFromTop(couplingTitleHeight);
+        couplingCellHeight = area.getHeight() / (maxPlayers + 1);
+        couplingColumnWidth = area.getWidth() / maxPlayers;
+        couplingOrigin = area.getPosition();
+
+        for (int row = 0; row < maxPlayers; ++row)
+        {
+            for (int column = 0; column < maxPlayers; ++column)
+            {
+                int x = couplingOrigin.x + column * couplingColumnWidth;
+                int y = couplingOrigin.y + (row + 1) * couplingCellHeight;
+
+                cellBounds[(size_t) getCouplingCell(row, column, false)] = { x, y, couplingColumnWidth / 2, couplingCellHeight };
+                cellBounds[(size_t) getCouplingCell(row, column, true)] = { x + couplingColumnWidth / 2, y, couplingColumnWidth / 2, couplingCellHeight };
+            }
+        }
+#pragma endregion Positions of the alpha and beta knobs
+
+        hideTextEditor();
+        background = {};
+    }
+
+    //==============================================================================
+    void mouseDown(const juce::MouseEvent& e) override
+    {
+        hideTextEditor();
+
+        int cell = getCellAt(e.getPosition());
+        if (cell < 0)
+            return;
+
+        if (isChannelCell(cell))
+        {
+            showChannelMenu(cell);
+            return;
+        }
+
+        draggedCell = cell;
+        dragStartValue = values[(size_t) cell];
+    }
+
+    void mouseDrag(const juce::MouseEvent& e) override
+    {
+        if (draggedCell < 0)
+            return;
+
+        // Like a rotary slider: dragging up or right turns the knob up
+        auto range = getRange(draggedCell);
+        int pixels = e.getDistanceFromDragStartX() - e.getDistanceFromDragStartY();
+        setValue(draggedCell, dragStartValue + (range.maximum - range.minimum) * pixels / dragPixelsForFullRange);
+    }
+
+    void mouseUp(const juce::MouseEvent&) override
+    {
+        draggedCell = -1;
+    }
+
+    // Double-clicking a knob types its value in
+    void mouseDoubleClick(const juce::MouseEvent& e) override
+    {
+        int cell = getCellAt(e.getPosition());
+        if (cell < 0 || isChannelCell(cell))
+            return;
+
+        editedCell = cell;
+        valueEditor.setBounds(getTextBounds(cell));
+        valueEditor.setText(formatValue(cell), false);
+        valueEditor.setVisible(true);
+        valueEditor.grabKeyboardFocus();
+        valueEditor.selectAll();
+    }
+
+    void mouseWheelMove(const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel) override
+    {
+        int cell = getCellAt(e.getPosition());
+        if (cell < 0 || isChannelCell(cell) || wheel.deltaY == 0.0f)
+            return;
+
+        auto range = getRange(cell);
+        double step = juce::jmax(range.interval, (range.maximum - range.minimum) * 0.01);
+        bool up = (wheel.deltaY > 0.0f) != wheel.isReversed;
+        setValue(cell, values[(size_t) cell] + (up ? step : -step));
+    }
+
+    //==============================================================================
+    // Rows below numPlayers are user players, whose timing parameters and couplings are hidden
+    void updatePlayerSetup(int numPlayers)
+    {
+        numUserPlayers = juce::jlimit(0, maxPlayers, numPlayers);
+        hideTextEditor();
+        background = {};
+        repaint();
+    }
+
+    // Method to get parameters for a specific player
+    PlayerParameters getPlayerParameters(int playerIndex) const
+    {
+        jassert(playerIndex >= 0 && playerIndex < maxPlayers); // Ensure the index is valid
+
+        PlayerParameters params;
+
+        params.id = playerIndex + 1; // Assign the player ID (1-based index)
+        params.isUser = playerIndex < numUserPlayers;
+        params.midiChannel = (int) values[(size_t) getPlayerCell(playerIndex, channelColumn)];
+        params.volume = values[(size_t) getPlayerCell(playerIndex, volumeColumn)];
+        params.delay = values[(size_t) getPlayerCell(playerIndex, delayColumn)];
+        params.motorNoiseSTD = values[(size_t) getPlayerCell(playerIndex, motorNoiseColumn)];
+        params.timeKeeperNoiseSTD = values[(size_t) getPlayerCell(playerIndex, timeKeeperNoiseColumn)];
+
+        return params;
+    }
+
+    // Sets a player's delay, such as one measured by latency calibration
+    void setPlayerDelay(int playerIndex, double delayMs)
+    {
+        jassert(playerIndex >= 0 && playerIndex < maxPlayers);
+        setValue(getPlayerCell(playerIndex, delayColumn), delayMs);
+    }
+
+    // Function to get alpha and beta values for a specific player
+    PlayerAlphaAndBeta getAlphasAndBetas(int playerRow) const
+    {
+        PlayerAlphaAndBeta params = {};
+
+        // Ensure the row is within valid range
+        if (playerRow < 0 || playerRow >= maxPlayers)
+            return params;
+
+        for (int column = 0; column < maxPlayers; ++column)
+        {
+            params.alphas[column] = values[(size_t) getCouplingCell(playerRow, column, false)];
+            params.betas[column] = values[(size_t) getCouplingCell(playerRow, column, true)];
+        }
+
+        return params;
+    }
+
+private:
+    // Cells are numbered player table first (row-major), then the coupling matrix with the
+    // alpha and beta of each pair next to each other
+    enum PlayerColumn
+    {
+        channelColumn,
+        volumeColumn,
+        delayColumn,
+        motorNoiseColumn,
+        timeKeeperNoiseColumn,
+        numPlayerColumns
+    };
+
+    static constexpr int firstCouplingCell = maxPlayers * numPlayerColumns;
+    static constexpr int numCells = firstCouplingCell + maxPlayers * maxPlayers * 2;
+    static constexpr int textBoxWidth = 50;
+    static constexpr int textBoxHeight = 20;
+    static constexpr double dragPixelsForFullRange = 250.0;
+    static constexpr float rotaryStartAngle = juce::MathConstants<float>::pi * 1.2f;
+    static constexpr float rotaryEndAngle = juce::MathConstants<float>::pi * 2.8f;
+
+    struct ValueRange
+    {
+        double minimum, maximum, interval;
+        int decimalPlaces;
+        juce::Colour thumbColour;
+    };
+
+    static int getPlayerCell(int row, int column) { return row * numPlayerColumns + column; }
+    static int getCouplingCell(int row, int column, bool isBeta) { return firstCouplingCell + (row * maxPlayers + column) * 2 + (isBeta ? 1 : 0); }
+    static int getRow(int cell) { return cell < firstCouplingCell ? cell / numPlayerColumns : (cell - firstCouplingCell) / (2 * maxPlayers); }
+    static bool isChannelCell(int cell) { return cell < firstCouplingCell && cell % numPlayerColumns == channelColumn; }
+
+    static ValueRange getRange(int cell)
+    {
+        if (cell >= firstCouplingCell)
+            return (cell - firstCouplingCell) % 2 == 0 ? ValueRange { 0.0, 1.0, 0.01, 2, juce::Colours::red }      // Alpha
+                                                       : ValueRange { 0.0, 1.0, 0.01, 2, juce::Colours::orange };  // Beta
+
+        switch (cell % numPlayerColumns)
+        {
+        case channelColumn:         return { 1.0, 15.0, 1.0, 0, juce::Colours::white };
+        case volumeColumn:          return { 0.0, 1.0, 0.01, 2, juce::Colour(0xff42a2c8) };
+        case delayColumn:           return { 0.0, 200.0, 0.01, 2, juce::Colours::seagreen };   // Fine enough for a calibrated delay
+        case motorNoiseColumn:      return { 0.0, 10.0, 0.01, 2, juce::Colours::seagreen };
+        case timeKeeperNoiseColumn: return { 0.0, 50.0, 0.01, 2, juce::Colours::seagreen };
+        default: break;
+        }
+
+        jassertfalse;
+        return { 0.0, 1.0, 0.01, 2, juce::Colours::white };
+    }
+
+    bool isCellVisible(int cell) const
+    {
+        if (getRow(cell) >= numUserPlayers)
+            return true;
+
+        // User players only keep their MIDI channel and volume
+        return cell < firstCouplingCell && cell % numPlayerColumns <= volumeColumn;
+    }
+
+    int getCellAt(juce::Point<int> position) const
+    {
+        for (int cell = 0; cell < numCells; ++cell)
+            if (isCellVisible(cell) && cellBounds[(size_t) cell].contains(position))
+                return cell;
+
+        return -1;
+    }
+
+    void setValue(int cell, double newValue)
+    {
+        auto range = getRange(cell);
+        newValue = juce::jlimit(range.minimum, range.maximum, newValue);
+        newValue = range.minimum + range.interval * std::round((newValue - range.minimum) / range.interval);
+
+        if (newValue == values[(size_t) cell])
+            return;
+
+        values[(size_t) cell] = newValue;
+        repaint(cellBounds[(size_t) cell]);
+    }
+
+    juce::String formatValue(int cell) const
+    {
+        return juce::String(values[(size_t) cell], getRange(cell).decimalPlaces);
+    }
+
+    juce::Rectangle<float> getKnobBounds(int cell) const
+    {
+        auto area = cellBounds[(size_t) cell].withTrimmedBottom(textBoxHeight).toFloat().reduced(4.0f);
+        auto size = juce::jmin(area.getWidth(), area.getHeight());
+        return area.withSizeKeepingCentre(size, size);
+    }
+
+    juce::Rectangle<int> getTextBounds(int cell) const
+    {
+        auto area = cellBounds[(size_t) cell];
+        return area.removeFromBottom(textBoxHeight).withSizeKeepingCentre(juce::jmin(textBoxWidth, area.getWidth()), textBoxHeight);
+    }
+
+    //==============================================================================
+    void renderBackground(float scale)
+    {
+        TraceLog::ScopedTrace trace("parameter grid background", "gui");
+
+        backgroundScale = scale;
+        background = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                                 juce::jmax(1, juce::roundToInt(getHeight() * scale)), false);
+
+        juce::Graphics g(background);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        g.fillAll(juce::Colours::black.brighter(0.12f));
+        g.setColour(juce::Colours::white);
+
+#pragma region Player Table
+        const juce::StringArray columnNames = { "Player", "MIDI Channel", "Volume", "Delay\n(ms)", "Motor Noise\nSTD\n(ms)", "Time Keeper \nNoise STD\n(ms)" };
+
+        g.setFont(juce::FontOptions(15.0f));
+        for (int i = 0; i < columnNames.size(); ++i)
+            g.drawFittedText(columnNames[i], playerTableOrigin.x + i * playerColumnWidth, playerTableOrigin.y, playerColumnWidth, playerCellHeight,
+                             juce::Justification::centred, 3);
+
+        g.setFont(juce::FontOptions(20.0f));
+        for (int row = 0; row < maxPlayers; ++row)
+            g.drawText(juce::String(row + 1), playerTableOrigin.x, playerTableOrigin.y + (row + 1) * playerCellHeight, playerColumnWidth, playerCellHeight,
+                       juce::Justification::centred);
+#pragma endregion Column headings and player numbers
+
+#pragma region Coupling Matrix
+        g.setFont(juce::FontOptions(30.0f));
+        g.drawText("Alphas and Betas", couplingArea.withHeight(couplingTitleHeight + 20), juce::Justification::centred);
+
+        g.setFont(juce::FontOptions(15.0f));
+        for (int column = 0; column < maxPlayers; ++column)
+            g.drawFittedText("Player " + juce::String(column + 1) + "\nAlpha       Beta",
+                             couplingOrigin.x + column * couplingColumnWidth, couplingOrigin.y, couplingColumnWidth, couplingCellHeight,
+                             juce::Justification::centredBottom, 2);
+#pragma endregion Title and column headings
+
+        for (int cell = 0; cell < numCells; ++cell)
+            if (isCellVisible(cell))
+                drawCellBackground(g, cell);
+    }
+
+    // The parts of a cell that do not change with its value
+    void drawCellBackground(juce::Graphics& g, int cell) const
+    {
+        if (isChannelCell(cell))
+        {
+            auto box = cellBounds[(size_t) cell].toFloat();
+            g.setColour(juce::Colours::black.brighter(0.25f));
+            g.fillRoundedRectangle(box, 3.0f);
+            g.setColour(juce::Colours::grey);
+            g.drawRoundedRectangle(box.reduced(0.5f), 3.0f, 1.0f);
+
+            // Drop-down arrow
+            auto arrow = box.removeFromRight(box.getHeight()).reduced(box.getHeight() * 0.35f);
+            juce::Path path;
+            path.startNewSubPath(arrow.getX(), arrow.getY());
+            path.lineTo(arrow.getCentreX(), arrow.getBottom());
+            path.lineTo(arrow.getRight(), arrow.getY());
+            g.strokePath(path, juce::PathStrokeType(2.0f));
+            return;
+        }
+
+        auto knob = getKnobBounds(cell);
+        auto radius = knob.getWidth() / 2.0f;
+        auto lineWidth = juce::jmin(8.0f, radius * 0.5f);
+        auto arcRadius = radius - lineWidth * 0.5f;
+
+        juce::Path track;
+        track.addCentredArc(knob.getCentreX(), knob.getCentreY(), arcRadius, arcRadius, 0.0f, rotaryStartAngle, rotaryEndAngle, true);
+        g.setColour(juce::Colours::black.brighter(0.35f));
+        g.strokePath(track, juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+
+        g.setColour(juce::Colours::grey);
+        g.drawRect(getTextBounds(cell));
+    }
+
+    // The value arc, thumb and text, drawn on top of the cached background
+    void drawCellValue(juce::Graphics& g, int cell) const
+    {
+        g.setColour(juce::Colours::white);
+        g.setFont(juce::FontOptions(15.0f));
+
+        if (isChannelCell(cell))
+        {
+            auto box = cellBounds[(size_t) cell];
+            g.drawText(formatValue(cell), box.withTrimmedRight(box.getHeight()).withTrimmedLeft(6), juce::Justification::centredLeft);
+            return;
+        }
+
+        auto range = getRange(cell);
+        auto proportion = (float) ((values[(size_t) cell] - range.minimum) / (range.maximum - range.minimum));
+        auto angle = rotaryStartAngle + proportion * (rotaryEndAngle - rotaryStartAngle);
+
+        auto knob = getKnobBounds(cell);
+        auto radius = knob.getWidth() / 2.0f;
+        auto lineWidth = juce::jmin(8.0f, radius * 0.5f);
+        auto arcRadius = radius - lineWidth * 0.5f;
+
+        if (proportion > 0.0f)
+        {
+            juce::Path arc;
+            arc.addCentredArc(knob.getCentreX(), knob.getCentreY(), arcRadius, arcRadius, 0.0f, rotaryStartAngle, angle, true);
+            g.strokePath(arc, juce::PathStrokeType(lineWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded));
+        }
+
+        auto thumb = knob.getCentre().getPointOnCircumference(arcRadius, angle);
+        g.setColour(range.thumbColour);
+        g.fillEllipse(juce::Rectangle<float>(lineWidth * 2.0f, lineWidth * 2.0f).withCentre(thumb));
+
+        g.setColour(juce::Colours::white);
+        g.drawText(formatValue(cell), getTextBounds(cell), juce::Justification::centred);
+    }
+
+    //==============================================================================
+    void showChannelMenu(int cell)
+    {
+        juce::PopupMenu menu;
+        for (int channel = 1; channel <= 15; ++channel)
+            menu.addItem(channel, juce::String(channel), true, channel == (int) values[(size_t) cell]);
+
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetScreenArea(localAreaToGlobal(cellBounds[(size_t) cell])),
+                           [safeThis = juce::Component::SafePointer<ParameterGrid>(this), cell](int result)
+                           {
+                               if (safeThis != nullptr && result > 0)
+                                   safeThis->setValue(cell, result);
+                           });
+    }
+
+    void commitTextEdit()
+    {
+        if (editedCell >= 0)
+            setValue(editedCell, valueEditor.getText().getDoubleValue());
+
+        hideTextEditor();
+    }
+
+    void hideTextEditor()
+    {
+        editedCell = -1;
+        valueEditor.setVisible(false);
+    }
+
+    std::array<double, numCells> values {};
+    std::array<juce::Rectangle<int>, numCells> cellBounds {};
+    int numUserPlayers = 0;
+
+    // Layout, worked out in resized()
+    juce::Rectangle<int> playersArea, couplingArea;
+    juce::Point<int> playerTableOrigin, couplingOrigin;
+    int playerCellHeight = 0, playerColumnWidth = 0;
+    int couplingTitleHeight = 0, couplingCellHeight = 0, couplingColumnWidth = 0;
+
+    juce::Image background;
+    float backgroundScale = 1.0f;
+
+    int draggedCell = -1;
+    double dragStartValue = 0.0;
+
+    // One shared editor for typing in values
+    juce::TextEditor valueEditor;
+    int editedCell = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterGrid)
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "OnsetFifo.h"
+#include "PluginProcessor.h"
+#include "ScoreOverview.h"
+#include "TraceLog.h"
+
+//==============================================================================
+// PianoRollOverview - the whole score with one lane per player, the ensemble's playhead and
+// the onsets it has played so far drawn over it.
+//
+// The notes come from the score's ScoreOverview, picked up as soon as the score cache has
+// built it. Each column of pixels reads the one pyramid level whose bins are just narrower
+// than the column, so drawing costs the same for any score length and zoom. Played onsets are
+// looked up per column too, at most a few each.
+//
+// Mouse wheel zooms around the mouse, dragging scrolls, double-click shows the whole score.
+// While zoomed in, the view follows the playhead once it passes the right edge.
+class PianoRollOverview : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int maxPlayers = OnsetRecord::maxPlayers;
+
+    explicit PianoRollOverview(AdaptiveMetronomeAudioProcessor& processor) : audioProcessor(processor)
+    {
+        setOpaque(true);
+        startTimerHz(30);
+    }
+
+    ~PianoRollOverview() override
+    {
+        stopTimer();
+    }
+
+    // Called for every onset the editor's monitor takes from the OnsetFifo
+    void addOnsetRecord(const OnsetRecord& record)
+    {
+        if (overview == nullptr || record.onsetIndex < 0 || record.onsetIndex >= numOnsets)
+            return;
+
+        auto& played = playedOnsets[(size_t) record.onsetIndex];
+        played.playedMask = record.playedMask;
+        played.asynchronyMs = record.asynchronyMs;
+        hasNewOnsets = true;
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        TraceLog::ScopedTrace trace("piano roll paint", "gui");
+
+        g.fillAll(backgroundColour);
+        if (overview == nullptr)
+        {
+            g.setColour(juce::Colours::grey);
+            g.setFont(juce::FontOptions(16.0f));
+            g.drawText(audioProcessor.hasScore() ? "Building overview..." : "No score loaded", getLocalBounds(), juce::Justification::centred);
+            return;
+        }
+
+        auto area = getLocalBounds();
+        auto labels = area.removeFromLeft(labelWidth);
+        int numLanes = juce::jmin(audioProcessor.players.size(), maxPlayers);
+        if (numLanes == 0)
+            return;
+
+        int width = area.getWidth();
+        float laneHeight = (float) area.getHeight() / numLanes;
+        double quarterNotesPerPixel = viewLength / juce::jmax(1, width);
+        const auto& onsetPositions = overview->getOnsetQuarterNotes();
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto& player = audioProcessor.players.getReference(lane);
+            int channel = player.getMidiChannel();
+            auto laneTop = (float) area.getY() + lane * laneHeight;
+            auto colour = getPlayerColour(lane);
+
+            g.setColour(colour);
+            g.setFont(juce::FontOptions(14.0f));
+            g.drawText("Player " + juce::String(lane + 1), labels.getX(), juce::roundToInt(laneTop), labels.getWidth(),
+                       juce::roundToInt(laneHeight), juce::Justification::centredLeft);
+
+            g.setColour(juce::Colours::grey.withAlpha(0.3f));
+            g.fillRect((float) area.getX(), laneTop + laneHeight - 1.0f, (float) width, 1.0f);
+
+            if (!overview->hasChannel(channel))
+                continue;
+
+            // Notes, as the pitch range sounding in each column, brighter where they are denser
+            auto range = overview->getChannelRange(channel);
+            auto lowest = (float) range.lowestNote - 1.0f;
+            auto pitchSpan = juce::jmax(1.0f, (float) range.highestNote + 1.0f - lowest);
+            auto noteTop = laneTop + 3.0f;
+            auto noteHeight = laneHeight - 6.0f;
+            int level = overview->getLevelFor(channel, quarterNotesPerPixel);
+
+            for (int x = 0; x < width; ++x)
+            {
+                auto start = viewStart + x * quarterNotesPerPixel;
+                auto cell = overview->getCell(channel, level, start, start + quarterNotesPerPixel);
+                if (cell.isEmpty())
+                    continue;
+
+                auto top = noteTop + noteHeight * (1.0f - ((float) cell.highestNote + 1.0f - lowest) / pitchSpan);
+                auto bottom = noteTop + noteHeight * (1.0f - ((float) cell.lowestNote - lowest) / pitchSpan);
+                g.setColour(colour.withAlpha(juce::jlimit(0.25f, 1.0f, 0.25f + 0.75f * cell.occupancy)));
+                g.fillRect((float) (area.getX() + x), top, 1.0f, juce::jmax(1.0f, bottom - top));
+            }
+
+            // Played onsets, as ticks above or below the lane's centre line for late or early
+            g.setColour(juce::Colours::white.withAlpha(0.8f));
+            auto centre = laneTop + laneHeight * 0.5f;
+            for (int x = 0; x < width; ++x)
+            {
+                auto start = viewStart + x * quarterNotesPerPixel;
+                auto first = (int) (std::lower_bound(onsetPositions.begin(), onsetPositions.end(), start) - onsetPositions.begin());
+                for (int onset = first, checked = 0; onset < numOnsets && onsetPositions[(size_t) onset] < start + quarterNotesPerPixel
+                                                     && checked < maxOnsetsPerColumn; ++onset, ++checked)
+                {
+                    const auto& played = playedOnsets[(size_t) onset];
+                    if ((played.playedMask & (1u << lane)) == 0)
+                        continue;
+
+                    auto offset = juce::jlimit(-1.0f, 1.0f, played.asynchronyMs[(size_t) lane] / laneRangeMs);
+                    g.fillRect((float) (area.getX() + x), juce::jmin(centre, centre + offset * laneHeight * 0.45f), 1.0f,
+                               juce::jmax(2.0f, std::abs(offset) * laneHeight * 0.45f));
+                    break;
+                }
+            }
+        }
+
+        // Playhead
+        auto playheadX = (float) area.getX() + (float) ((playhead - viewStart) / quarterNotesPerPixel);
+        if (playheadX >= (float) area.getX() && playheadX < (float) area.getRight())
+        {
+            g.setColour(juce::Colours::white);
+            g.fillRect(playheadX, (float) area.getY(), 1.5f, (float) area.getHeight());
+        }
+    }
+
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override
+    {
+        if (overview == nullptr)
+            return;
+
+        // Zooms around the position under the mouse
+        auto anchor = positionAt(event.x);
+        auto newLength = juce::jlimit(minimumViewLength, getScoreLength(), viewLength * std::pow(2.0, -wheel.deltaY * 4.0));
+        viewStart = anchor - (anchor - viewStart) * newLength / viewLength;
+        viewLength = newLength;
+        clampView();
+        repaint();
+    }
+
+    void mouseDown(const juce::MouseEvent&) override
+    {
+        dragStart = viewStart;
+    }
+
+    void mouseDrag(const juce::MouseEvent& event) override
+    {
+        if (overview == nullptr)
+            return;
+
+        viewStart = dragStart - event.getDistanceFromDragStartX() * viewLength / juce::jmax(1, getWidth() - labelWidth);
+        clampView();
+        repaint();
+    }
+
+    void mouseDoubleClick(const juce::MouseEvent&) override
+    {
+        viewStart = 0.0;
+        viewLength = getScoreLength();
+        repaint();
+    }
+
+private:
+    struct PlayedOnset
+    {
+        juce::uint32 playedMask = 0;
+        std::array<float, maxPlayers> asynchronyMs {};
+    };
+
+    static constexpr int labelWidth = 70;
+    static constexpr int maxOnsetsPerColumn = 4;
+    static constexpr float laneRangeMs = 50.0f;         // Asynchrony that reaches the edge of a lane
+    static constexpr double minimumViewLength = 4.0;    // Quarter notes
+
+    static juce::Colour getPlayerColour(int player)
+    {
+        const juce::Colour colours[] = { juce::Colours::skyblue, juce::Colours::seagreen, juce::Colours::orange, juce::Colours::orchid };
+        return colours[player % maxPlayers];
+    }
+
+    void timerCallback() override
+    {
+        // A newly loaded score replaces the overview once the cache has built it
+        auto latest = audioProcessor.getScoreOverview();
+        if (latest.get() != overview.get())
+        {
+            overview = latest;
+            numOnsets = overview != nullptr ? (int) overview->getOnsetQuarterNotes().size() : 0;
+            playedOnsets.assign((size_t) numOnsets, {});
+            viewStart = 0.0;
+            viewLength = getScoreLength();
+            repaint();
+            return;
+        }
+
+        if (overview == nullptr)
+            return;
+
+        auto newPlayhead = audioProcessor.getEnsemblePosition();
+        if (newPlayhead == playhead && !hasNewOnsets)
+            return;
+
+        // Pages along with the playhead while zoomed in, unless it had been scrolled out of view
+        bool wasVisible = playhead >= viewStart && playhead <= viewStart + viewLength;
+        playhead = newPlayhead;
+        hasNewOnsets = false;
+
+        if (viewLength < getScoreLength() && wasVisible && playhead > viewStart + viewLength)
+        {
+            viewStart = playhead - 0.1 * viewLength;
+            clampView();
+        }
+
+        repaint();
+    }
+
+    double getScoreLength() const { return overview != nullptr ? juce::jmax(minimumViewLength, overview->getLengthQuarterNotes()) : minimumViewLength; }
+    double positionAt(int x) const { return viewStart + (x - labelWidth) * viewLength / juce::jmax(1, getWidth() - labelWidth); }
+
+    void clampView()
+    {
+        viewStart = juce::jlimit(0.0, juce::jmax(0.0, getScoreLength() - viewLength), viewStart);
+    }
+
+    AdaptiveMetronomeAudioProcessor& audioProcessor;
+    const juce::Colour backgroundColour = juce::Colours::black.brighter(0.12f);
+
+    ScoreOverview::Ptr overview;
+    int numOnsets = 0;
+    std::vector<PlayedOnset> playedOnsets;      // Per score onset, the last time it was played
+    bool hasNewOnsets = false;
+
+    double viewStart = 0.0, viewLength = minimumViewLength;    // Quarter notes
+    double dragStart = 0.0;
+    double playhead = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoRollOverview)
+};
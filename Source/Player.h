@@ -21,7 +21,7 @@ public:
     // Constructor
     Player(int id, bool isUser, int midiChannel, float volume, float delay, float motorNoiseSTD, float timeKeeperNoiseSTD,
         const std::array<double, 4>& alphas, const std::array<double, 4>& betas)
-        : id(id), midiChannel(midiChannel), volume(volume), delay(delay),
+        : id(id), isUser(isUser), midiChannel(midiChannel), volume(volume), delay(delay),
         motorNoiseSTD(motorNoiseSTD), timeKeeperNoiseSTD(timeKeeperNoiseSTD),
         alphas(alphas), betas(betas) {}
 
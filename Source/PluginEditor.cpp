@@ -1,6 +1,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "Player.h"
+#include "TraceLog.h"
 
 #define WINDOW_MARGIN 10
 
@@ -8,7 +9,7 @@
 // This focus on the GUI of the Plugin
 //==============================================================================
 AdaptiveMetronomeAudioProcessorEditor::AdaptiveMetronomeAudioProcessorEditor(AdaptiveMetronomeAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), ensembleMonitor(p.getOnsetFifo(), p.getSchedulingStatistics()), pianoRoll(p)
 {
     // Fix the size of the plugin GUI and make it unresizable
     setSize(1250, 650);
@@ -19,6 +20,7 @@ AdaptiveMetronomeAudioProcessorEditor::AdaptiveMetronomeAudioProcessorEditor(Ada
     loadMidiBtn.setButtonText("Load MIDI");
     loadMidiBtn.onClick = [this] {
         DBG("Load MIDI button has been pressed");
+        loadMidiFile();
         };
 
     // Config and Reset should initially be set to disabled until a MIDI is loaded
@@ -41,8 +43,7 @@ AdaptiveMetronomeAudioProcessorEditor::AdaptiveMetronomeAudioProcessorEditor(Ada
     noPlayerCB.onChange = [this]
         {
             int numPlayers = noPlayerCB.getSelectedItemIndex();
-            playersSection.updatePlayerSetup(numPlayers);
-            alphasAndBetas.updatePlayerSetup(numPlayers);
+            parameterGrid.updatePlayerSetup(numPlayers);
         };
 
     addAndMakeVisible(noPlayerLB);
@@ -50,9 +51,94 @@ AdaptiveMetronomeAudioProcessorEditor::AdaptiveMetronomeAudioProcessorEditor(Ada
     noPlayerLB.setFont(juce::Font(25.0f));
     noPlayerLB.attachToComponent(&noPlayerCB, true);
 
-    // Adding Section for the Players and Alphas/Betas
-    addAndMakeVisible(playersSection);
-    addAndMakeVisible(alphasAndBetas);
+    // Adding the grid for the Players and Alphas/Betas
+    addAndMakeVisible(parameterGrid);
+
+    // The live monitor and the score overview take the grid's place while they are shown
+    addChildComponent(ensembleMonitor);
+    addChildComponent(pianoRoll);
+    ensembleMonitor.onOnsetRecord = [this](const OnsetRecord& record) {
+        pianoRoll.addOnsetRecord(record);
+        };
+
+    addAndMakeVisible(monitorBtn);
+    monitorBtn.setButtonText("Show Monitor");
+    monitorBtn.onClick = [this] {
+        bool showMonitor = !ensembleMonitor.isVisible();
+        ensembleMonitor.setVisible(showMonitor);
+        pianoRoll.setVisible(showMonitor);
+        parameterGrid.setVisible(!showMonitor);
+        monitorBtn.setButtonText(showMonitor ? "Show Parameters" : "Show Monitor");
+        };
+
+    // Joins other instances over the network, each playing some of the players
+    addAndMakeVisible(networkBtn);
+    networkBtn.setButtonText("Network");
+    networkBtn.onClick = [this] {
+        showNetworkWindow();
+        };
+
+    // Taps can also come from OSC devices, sending "/metronome/tap <MIDI channel>"
+    addAndMakeVisible(oscMessageBtn);
+    oscMessageBtn.setButtonText("OSC Input");
+    oscMessageBtn.onClick = [this] {
+        if (audioProcessor.getOscInput().isRunning())
+        {
+            audioProcessor.stopOscInput();
+            oscMessageBtn.setButtonText("OSC Input");
+            updateStatusLabel("OSC input off");
+        }
+        else if (audioProcessor.startOscInput(OscInput::defaultPort))
+        {
+            oscMessageBtn.setButtonText("OSC Off");
+            updateStatusLabel("OSC taps on port " + juce::String(OscInput::defaultPort));
+        }
+        else
+        {
+            updateStatusLabel("Could not open OSC port " + juce::String(OscInput::defaultPort));
+        }
+        };
+
+    // Measures each computer player's delay by playing clicks and listening for them on the input
+    addAndMakeVisible(calibrateBtn);
+    calibrateBtn.setButtonText("Calibrate");
+    calibrateBtn.onClick = [this] {
+        showCalibrationWindow();
+        };
+
+    // Sends MIDI clock that follows the ensemble's tempo, for drum machines and lighting rigs
+    addAndMakeVisible(midiClockBtn);
+    midiClockBtn.setButtonText(audioProcessor.isMidiClockEnabled() ? "Clock Off" : "MIDI Clock");
+    midiClockBtn.onClick = [this] {
+        bool enable = !audioProcessor.isMidiClockEnabled();
+        audioProcessor.setMidiClockEnabled(enable);
+        midiClockBtn.setButtonText(enable ? "Clock Off" : "MIDI Clock");
+        updateStatusLabel(enable ? "MIDI clock on" : "MIDI clock off");
+        };
+
+    // Predictive steps on the users' predicted onsets; reactive waits for every tap
+    addAndMakeVisible(schedulingBtn);
+    schedulingBtn.setButtonText(audioProcessor.isPredictiveScheduling() ? "Predictive" : "Reactive");
+    schedulingBtn.onClick = [this] {
+        bool predictive = !audioProcessor.isPredictiveScheduling();
+        audioProcessor.setPredictiveScheduling(predictive);
+        schedulingBtn.setButtonText(predictive ? "Predictive" : "Reactive");
+        updateStatusLabel(predictive ? "Predictive scheduling" : "Reactive scheduling");
+        };
+
+    // Further ensembles of the grid's players on channels of their own, for group experiments
+    addAndMakeVisible(groupBtn);
+    groupBtn.setButtonText("Group");
+    groupBtn.onClick = [this] {
+        showGroupWindow();
+        };
+
+    // Timeline tracing can be switched on in any build to diagnose timing jitter
+    addAndMakeVisible(traceBtn);
+    traceBtn.setButtonText(TraceLog::isEnabled() ? "Save Trace" : "Start Trace");
+    traceBtn.onClick = [this] {
+        toggleTrace();
+        };
 
     // Adding Status Message
     addAndMakeVisible(statusLB);
@@ -77,14 +163,23 @@ AdaptiveMetronomeAudioProcessorEditor::AdaptiveMetronomeAudioProcessorEditor(Ada
         };
 #endif
 
-    
+    // Follows a calibration while one runs, and otherwise the network's transports
+    startTimer(100);
 }
 
-AdaptiveMetronomeAudioProcessorEditor::~AdaptiveMetronomeAudioProcessorEditor() = default;
+AdaptiveMetronomeAudioProcessorEditor::~AdaptiveMetronomeAudioProcessorEditor()
+{
+    // A calibration left running would keep the ensemble silent with nothing to end it
+    if (audioProcessor.getLatencyCalibrator().isRunning())
+        audioProcessor.cancelLatencyCalibration();
+}
 
 //==============================================================================
 void AdaptiveMetronomeAudioProcessorEditor::paint(juce::Graphics& g)
 {
+    TraceLog::ScopedTrace trace("editor paint", "gui");
+    TraceLog::setThreadName("Message");
+
     g.fillAll(juce::Colours::black.brighter(0.1f));
     g.setColour(juce::Colours::white);
     g.setFont(juce::FontOptions(36.0f));
@@ -109,7 +204,11 @@ void AdaptiveMetronomeAudioProcessorEditor::resized()
     loadMidiBtn.setBounds(loadMidiBtnX, buttonY, buttonWidth, componentHeight);
     loadCongifBtn.setBounds(loadConfigBtnX, buttonY, buttonWidth, componentHeight);
     resetBtn.setBounds(resetBtnX, buttonY, buttonWidth, componentHeight);
-#pragma endregion Setting the Position of the Buttons (MIDI, Config, and Reset)
+
+    // The ensemble settings start from the left, clear of the player count's label
+    schedulingBtn.setBounds(WINDOW_MARGIN, buttonY, buttonWidth, componentHeight);
+    groupBtn.setBounds(schedulingBtn.getRight() + gap, buttonY, buttonWidth, componentHeight);
+#pragma endregion Setting the Position of the Buttons (MIDI, Config, Reset, Scheduling and Group)
 
 #pragma region ComboBox - Number of Players
     int comboBoxWidth = 100;
@@ -117,36 +216,319 @@ void AdaptiveMetronomeAudioProcessorEditor::resized()
     noPlayerCB.setBounds(resetBtnX - comboBoxWidth - gap, buttonY + (componentHeight - comboBoxHeight) / 2, comboBoxWidth, comboBoxHeight);
 #pragma endregion Setting Position of ComboBox
 
-#pragma region Player Parameters
-    int playerSectionY = 60; // Start of the Player Parameters section
-    int playerSectionWidth = getWidth() / 2 - WINDOW_MARGIN; // Half of the window width
-    int playerSectionHeight = getHeight() - playerSectionY - componentHeight - gap; // Remaining height after buttons
-    playersSection.setBounds(WINDOW_MARGIN, playerSectionY, playerSectionWidth, playerSectionHeight);
-#pragma endregion Setting Position of Player Parameters
+#pragma region Parameter Grid
+    // Debug builds keep a row of their own between the grid and the buttons
+#if JUCE_DEBUG
+    int debugRowHeight = 30;
+    int debugRowY = buttonY - debugRowHeight - gap;
+    int parameterGridBottom = debugRowY;
+#else
+    int parameterGridBottom = buttonY;
+#endif
 
-#pragma region AlphasAndBetas Section
-    int alphasAndBetasSectionWidth = getWidth() / 2 - WINDOW_MARGIN; // Other half of the window width
-    int alphasAndBetasSectionHeight = getHeight() - playerSectionY - componentHeight - gap;
-    alphasAndBetas.setBounds(playerSectionWidth + WINDOW_MARGIN, playerSectionY, alphasAndBetasSectionWidth, alphasAndBetasSectionHeight);
-#pragma endregion Setting Position of AlphasAndBetas Section
+    int parameterGridY = 60; // Start of the Player Parameters and Alphas/Betas
+    int pianoRollHeight = 150;
+    int parameterGridWidth = getWidth() - 2 * WINDOW_MARGIN;
+    int parameterGridHeight = parameterGridBottom - parameterGridY - gap; // Remaining height after buttons
+    parameterGrid.setBounds(WINDOW_MARGIN, parameterGridY, parameterGridWidth, parameterGridHeight);
+    auto monitorArea = parameterGrid.getBounds();
+    pianoRoll.setBounds(monitorArea.removeFromBottom(pianoRollHeight));
+    monitorArea.removeFromBottom(gap);
+    ensembleMonitor.setBounds(monitorArea);
+#pragma endregion Setting Position of the Player Parameters and AlphasAndBetas
 
 #pragma region Status Label
-    int statusLabelWidth = 300;
+    int statusLabelWidth = 250;
     int statusLabelHeight = 30;
     statusLB.setBounds(getWidth() - statusLabelWidth - WINDOW_MARGIN, WINDOW_MARGIN, statusLabelWidth, statusLabelHeight);
     statusLB.setJustificationType(juce::Justification::centredRight); //Aligns the text on the right
+
+    int traceButtonWidth = 100;
+    traceBtn.setBounds(getWidth() - statusLabelWidth - traceButtonWidth - WINDOW_MARGIN - gap, WINDOW_MARGIN, traceButtonWidth, statusLabelHeight);
+
+    int monitorButtonWidth = 120;
+    monitorBtn.setBounds(traceBtn.getX() - monitorButtonWidth - gap, WINDOW_MARGIN, monitorButtonWidth, statusLabelHeight);
+
+    int networkButtonWidth = 85;
+    networkBtn.setBounds(monitorBtn.getX() - networkButtonWidth - gap, WINDOW_MARGIN, networkButtonWidth, statusLabelHeight);
+    oscMessageBtn.setBounds(networkBtn.getX() - networkButtonWidth - gap, WINDOW_MARGIN, networkButtonWidth, statusLabelHeight);
+    calibrateBtn.setBounds(oscMessageBtn.getX() - networkButtonWidth - gap, WINDOW_MARGIN, networkButtonWidth, statusLabelHeight);
+    midiClockBtn.setBounds(calibrateBtn.getX() - networkButtonWidth - gap, WINDOW_MARGIN, networkButtonWidth, statusLabelHeight);
 #pragma endregion Setting Position of Status Label
 
 #if JUCE_DEBUG
 #pragma region Save to CSV and Load Paramaters Button
     int checkboxWidth = 100;
-    int checkboxHeight = 30;
-    saveToCSVBtn.setBounds(WINDOW_MARGIN, getHeight() - checkboxHeight - WINDOW_MARGIN, checkboxWidth, checkboxHeight);
-    loadParamsBtn.setBounds(WINDOW_MARGIN + checkboxWidth + gap, getHeight() - checkboxHeight - WINDOW_MARGIN, checkboxWidth, checkboxHeight);
+    saveToCSVBtn.setBounds(WINDOW_MARGIN, debugRowY, checkboxWidth, debugRowHeight);
+    loadParamsBtn.setBounds(WINDOW_MARGIN + checkboxWidth + gap, debugRowY, checkboxWidth, debugRowHeight);
 #pragma endregion Setting Position of Save to CSV and Load Parameters
 #endif
 }
 
+// Opens a file chooser and hands the selected MIDI file to the processor to compile
+void AdaptiveMetronomeAudioProcessorEditor::loadMidiFile()
+{
+    fileChooser = std::make_unique<juce::FileChooser>("Select a MIDI score", juce::File(), "*.mid;*.midi");
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+
+    fileChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+        {
+            auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            if (audioProcessor.loadScore(file))
+            {
+                updateStatusLabel("Loaded " + file.getFileName());
+                loadCongifBtn.setEnabled(true);
+                resetBtn.setEnabled(true);
+            }
+            else
+            {
+                updateStatusLabel("Could not load " + file.getFileName());
+            }
+        });
+}
+
+// Starts recording a timeline, or stops and writes it as Chrome trace JSON to the documents folder
+void AdaptiveMetronomeAudioProcessorEditor::toggleTrace()
+{
+    if (!TraceLog::isEnabled())
+    {
+        TraceLog::clear();
+        TraceLog::setEnabled(true);
+        traceBtn.setButtonText("Save Trace");
+        updateStatusLabel("Tracing");
+        return;
+    }
+
+    TraceLog::setEnabled(false);
+    traceBtn.setButtonText("Start Trace");
+
+    auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("Adaptive Metronome Trace.json");
+    updateStatusLabel(TraceLog::writeChromeTrace(file) ? "Trace saved to " + file.getFileName() : "Could not save trace");
+}
+
+// Leaves the network, or asks for a port, the peers and which players they play before joining
+void AdaptiveMetronomeAudioProcessorEditor::showNetworkWindow()
+{
+    if (audioProcessor.getNetwork().isRunning())
+    {
+        auto statistics = audioProcessor.getNetwork().getStatistics();
+        audioProcessor.stopNetwork();
+        networkBtn.setButtonText("Network");
+        updateStatusLabel("Left network (" + juce::String(statistics.onsetsLost) + " lost, "
+                          + juce::String(statistics.onsetsTimedOut) + " timed out)");
+        return;
+    }
+
+    networkWindow = std::make_unique<juce::AlertWindow>("Network Ensemble",
+                                                        "Players listed as remote are played on the peers' instances.",
+                                                        juce::MessageBoxIconType::NoIcon, this);
+    networkWindow->addTextEditor("port", juce::String(NetworkEnsemble::defaultPort), "Local port");
+    networkWindow->addTextEditor("peers", "", "Peers (host:port, comma separated)");
+    networkWindow->addTextEditor("remote", "", "Remote players (e.g. 2, 4)");
+    networkWindow->addButton("Connect", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    networkWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    networkWindow->enterModalState(true, juce::ModalCallbackFunction::create([this](int result)
+        {
+            auto port = networkWindow->getTextEditorContents("port").getIntValue();
+            auto peers = juce::StringArray::fromTokens(networkWindow->getTextEditorContents("peers"), ",", "");
+            auto remote = juce::StringArray::fromTokens(networkWindow->getTextEditorContents("remote"), ", ", "");
+            networkWindow.reset();
+
+            if (result != 1)
+                return;
+
+            peers.trim();
+            peers.removeEmptyStrings();
+
+            juce::uint32 remoteMask = 0;
+            for (const auto& player : remote)
+            {
+                int number = player.getIntValue();
+                if (number >= 1 && number <= EnsembleModel::maxPlayers)
+                    remoteMask |= 1u << (number - 1);
+            }
+
+            if (audioProcessor.startNetwork(port, peers, remoteMask))
+            {
+                networkBtn.setButtonText("Disconnect");
+                updateStatusLabel("Listening on port " + juce::String(port));
+            }
+            else
+            {
+                updateStatusLabel("Could not open port " + juce::String(port));
+            }
+        }), false);
+}
+
+// Lists the group ensembles and their channels, and adds one of the grid's players or removes the last
+void AdaptiveMetronomeAudioProcessorEditor::showGroupWindow()
+{
+    auto describeChannels = [](const juce::Array<Player>& players, int channelOffset)
+        {
+            juce::StringArray channels;
+            for (const auto& player : players)
+                channels.add(juce::String(player.getMidiChannel() + channelOffset));
+            return channels.joinIntoString(", ");
+        };
+
+    auto players = GetPlayers();
+    juce::String message = "Each ensemble takes its taps and sends its notes on its own channels.\nMain ensemble: channels "
+                           + describeChannels(players, 0);
+    for (int i = 0; i < audioProcessor.getNumGroupEnsembles(); ++i)
+    {
+        const auto& ensemble = audioProcessor.getGroupEnsemble(i);
+        message << "\nEnsemble " << (i + 2) << ": channels " << describeChannels(ensemble.getPlayers(), ensemble.getChannelOffset());
+    }
+
+    auto freeOffset = audioProcessor.findFreeChannelOffset(players);
+    groupWindow = std::make_unique<juce::AlertWindow>("Group Ensembles", message, juce::MessageBoxIconType::NoIcon, this);
+    groupWindow->addTextEditor("offset", freeOffset != AdaptiveMetronomeAudioProcessor::noFreeChannelOffset ? juce::String(freeOffset) : juce::String(), "Channel offset for the grid's players");
+    groupWindow->addButton("Add", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    groupWindow->addButton("Remove Last", 2);
+    groupWindow->addButton("Close", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    groupWindow->enterModalState(true, juce::ModalCallbackFunction::create([this, players, describeChannels](int result)
+        {
+            auto offset = groupWindow->getTextEditorContents("offset").getIntValue();
+            groupWindow.reset();
+
+            if (result == 1)
+            {
+                if (audioProcessor.addGroupEnsemble(players, offset) >= 0)
+                    updateStatusLabel("Ensemble " + juce::String(audioProcessor.getNumGroupEnsembles() + 1) + " on channels "
+                                      + describeChannels(players, offset));
+                else
+                    updateStatusLabel("Channels taken or past 16");
+            }
+            else if (result == 2 && audioProcessor.getNumGroupEnsembles() > 0)
+            {
+                audioProcessor.removeGroupEnsemble(audioProcessor.getNumGroupEnsembles() - 1);
+                updateStatusLabel(juce::String(audioProcessor.getNumGroupEnsembles()) + " group ensembles");
+            }
+        }), false);
+}
+
+// Cancels a running calibration, or asks how to run one and starts it with the grid's players
+void AdaptiveMetronomeAudioProcessorEditor::showCalibrationWindow()
+{
+    if (audioProcessor.getLatencyCalibrator().isRunning())
+    {
+        audioProcessor.cancelLatencyCalibration();
+        followingCalibration = false;
+        calibrateBtn.setButtonText("Calibrate");
+        updateStatusLabel("Calibration cancelled");
+        return;
+    }
+
+    calibrationWindow = std::make_unique<juce::AlertWindow>("Latency Calibration",
+                                                            "Route the players' instruments (or the plugin's output) back into the plugin's input. "
+                                                            "The ensemble is silent while the clicks play.",
+                                                            juce::MessageBoxIconType::NoIcon, this);
+    calibrationWindow->addComboBox("source", { "Each player's instrument (MIDI)", "Plugin audio output" }, "Click from");
+    calibrationWindow->addTextEditor("trials", "12", "Clicks per player");
+    calibrationWindow->addTextEditor("input", "0", "Input latency to subtract (ms)");
+    calibrationWindow->addButton("Start", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    calibrationWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    calibrationWindow->enterModalState(true, juce::ModalCallbackFunction::create([this](int result)
+        {
+            LatencyCalibrator::Settings settings;
+            settings.source = calibrationWindow->getComboBoxComponent("source")->getSelectedItemIndex() == 1
+                                  ? LatencyCalibrator::ClickSource::audioOutput
+                                  : LatencyCalibrator::ClickSource::playerInstrument;
+            settings.numTrials = calibrationWindow->getTextEditorContents("trials").getIntValue();
+            settings.inputLatencyMs = juce::jmax(0.0, calibrationWindow->getTextEditorContents("input").getDoubleValue());
+            calibrationWindow.reset();
+
+            if (result != 1)
+                return;
+
+            if (audioProcessor.startLatencyCalibration(GetPlayers(), settings))
+            {
+                calibrateBtn.setButtonText("Cancel");
+                updateStatusLabel("Calibrating...");
+                followingCalibration = true;
+            }
+            else
+            {
+                updateStatusLabel("No computer players to calibrate");
+            }
+        }), false);
+}
+
+void AdaptiveMetronomeAudioProcessorEditor::timerCallback()
+{
+    if (followingCalibration)
+        followCalibration();
+    else
+        showTransportWarning();
+}
+
+void AdaptiveMetronomeAudioProcessorEditor::followCalibration()
+{
+    const auto& calibrator = audioProcessor.getLatencyCalibrator();
+    if (calibrator.isRunning())
+    {
+        updateStatusLabel("Calibrating " + juce::String(juce::roundToInt(calibrator.getProgress() * 100.0)) + "%");
+        return;
+    }
+
+    followingCalibration = false;
+    calibrateBtn.setButtonText("Calibrate");
+    if (!calibrator.isFinished())
+        return;
+
+    auto results = calibrator.getResults();
+    if (!audioProcessor.applyLatencyCalibration(GetPlayers()))
+    {
+        updateStatusLabel("No clicks heard on the input");
+        return;
+    }
+
+    // The grid shows what the processor now plays with
+    juce::String summary;
+    for (int i = 0; i < LatencyCalibrator::maxPlayers; ++i)
+    {
+        if (!results[(size_t) i].measured)
+            continue;
+
+        parameterGrid.setPlayerDelay(i, results[(size_t) i].delayMs);
+        summary << " " << (i + 1) << ": " << juce::String(results[(size_t) i].delayMs, 1)
+                << " +/- " << juce::String(results[(size_t) i].jitterMs, 1);
+        DBG("Player " + juce::String(i + 1) + " round trip " + juce::String(results[(size_t) i].roundTripMs, 3) + " ms, jitter "
+            + juce::String(results[(size_t) i].jitterMs, 3) + " ms, " + juce::String(results[(size_t) i].numDetected) + " clicks heard");
+    }
+
+    updateStatusLabel("Delays (ms)" + summary);
+}
+
+// Remote players can only be heard in time when every host's transport plays the score in step
+void AdaptiveMetronomeAudioProcessorEditor::showTransportWarning()
+{
+    const auto& network = audioProcessor.getNetwork();
+    if (!network.isRunning())
+    {
+        transportWarningShown = false;
+        return;
+    }
+
+    auto statistics = network.getStatistics();
+    auto offsetMs = statistics.transportOffsetMs;
+    bool outOfStep = statistics.hasTransportOffset && std::abs(offsetMs) > NetworkEnsemble::maxTransportOffsetMs;
+
+    if (outOfStep)
+        updateStatusLabel("Transport " + juce::String(std::abs(offsetMs), 0) + " ms " + (offsetMs > 0.0 ? "ahead of" : "behind")
+                          + " a peer - start the hosts together");
+    else if (transportWarningShown)
+        updateStatusLabel("Transport in step with the peers");
+
+    transportWarningShown = outOfStep;
+}
+
 void AdaptiveMetronomeAudioProcessorEditor::updateStatusLabel(const juce::String& message)
 {
     statusLB.setText(message, juce::dontSendNotification);
@@ -156,8 +538,8 @@ PlayerStruct AdaptiveMetronomeAudioProcessorEditor::GetPlayerParameters(int play
 {
     PlayerStruct player;
 
-    // Get the parameters from playersSection
-    auto playerParams = playersSection.getPlayerParameters(playerIndex);
+    // Get the parameters from the grid
+    auto playerParams = parameterGrid.getPlayerParameters(playerIndex);
     player.isUser = playerParams.isUser;
     player.id = playerParams.id;
     player.midiChannel = playerParams.midiChannel;
@@ -166,8 +548,8 @@ PlayerStruct AdaptiveMetronomeAudioProcessorEditor::GetPlayerParameters(int play
     player.motorNoiseSTD = playerParams.motorNoiseSTD;
     player.timeKeeperNoiseSTD = playerParams.timeKeeperNoiseSTD;
 
-    // Get the alpha and beta values from alphasAndBetas
-    auto alphaAndBetaParams = alphasAndBetas.getPlayerParameters(playerIndex);
+    // Get the alpha and beta values from the grid
+    auto alphaAndBetaParams = parameterGrid.getAlphasAndBetas(playerIndex);
     for (int i = 0; i < 4; ++i)
     {
         player.alphas[i] = alphaAndBetaParams.alphas[i];
@@ -226,7 +608,7 @@ void AdaptiveMetronomeAudioProcessorEditor::savePlayerParametersToCSV()
 
 }
 
-void AdaptiveMetronomeAudioProcessorEditor::UpdateModel()
+juce::Array<Player> AdaptiveMetronomeAudioProcessorEditor::GetPlayers()
 {
     // Create a JUCE array to store Player objects
     juce::Array<Player> players;
@@ -251,8 +633,15 @@ void AdaptiveMetronomeAudioProcessorEditor::UpdateModel()
         );
 
         players.add(player);
-        audioProcessor.UpdatePlayers(players);
     }
+
+    return players;
+}
+
+void AdaptiveMetronomeAudioProcessorEditor::UpdateModel()
+{
+    // Hand over the whole ensemble at once - the processor rebuilds its model on every update
+    audioProcessor.UpdatePlayers(GetPlayers());
     DBG("All players have been updated.");
 }
 
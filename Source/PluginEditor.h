@@ -2,15 +2,16 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
-#include "PlayersGUI.h"
-#include "AlphasAndBetas.h"
+#include "EnsembleMonitor.h"
+#include "PianoRollOverview.h"
+#include "ParameterGrid.h"
 #include "Player.h"
 
 //==============================================================================
 /**
 */
 
-class AdaptiveMetronomeAudioProcessorEditor  : public juce::AudioProcessorEditor
+class AdaptiveMetronomeAudioProcessorEditor  : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     AdaptiveMetronomeAudioProcessorEditor (AdaptiveMetronomeAudioProcessor&);
@@ -22,7 +23,13 @@ public:
     void updateStatusLabel(const juce::String&);
     PlayerStruct GetPlayerParameters(int);
     void savePlayerParametersToCSV();
+    juce::Array<Player> GetPlayers();
     void UpdateModel();
+    void loadMidiFile();
+    void toggleTrace();
+    void showNetworkWindow();
+    void showCalibrationWindow();
+    void showGroupWindow();
 
 private:
     AdaptiveMetronomeAudioProcessor& audioProcessor;
@@ -31,6 +38,13 @@ private:
     juce::TextButton loadCongifBtn;
     juce::TextButton resetBtn;
     juce::TextButton oscMessageBtn;
+    juce::TextButton traceBtn;
+    juce::TextButton monitorBtn;
+    juce::TextButton networkBtn;
+    juce::TextButton calibrateBtn;
+    juce::TextButton midiClockBtn;
+    juce::TextButton schedulingBtn;
+    juce::TextButton groupBtn;
 
 #if JUCE_DEBUG
     juce::TextButton saveToCSVBtn;
@@ -40,11 +54,24 @@ private:
     juce::ComboBox noPlayerCB;
     juce::Label noPlayerLB;
 
-    PlayersGUI playersSection;
-    AlphasAndBetas alphasAndBetas;
+    ParameterGrid parameterGrid;
+    EnsembleMonitor ensembleMonitor;    // Shown in place of the grid during a performance
+    PianoRollOverview pianoRoll;        // Shown under the monitor
 
     juce::Label statusLB;
 
+    std::unique_ptr<juce::FileChooser> fileChooser;
+    std::unique_ptr<juce::AlertWindow> networkWindow;
+    std::unique_ptr<juce::AlertWindow> calibrationWindow;
+    std::unique_ptr<juce::AlertWindow> groupWindow;
+
+    void timerCallback() override;     // Follows a latency calibration while it runs, otherwise the network
+    void followCalibration();
+    void showTransportWarning();
+
+    bool followingCalibration = false;
+    bool transportWarningShown = false;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AdaptiveMetronomeAudioProcessorEditor)
 };
@@ -1,6 +1,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "ComputerNotes.h"
 #include "Player.h"
+#include "RealtimeCheck.h"
+#include "TraceLog.h"
 
 //==============================================================================
 #pragma region Main Functions
@@ -26,31 +29,760 @@ AdaptiveMetronomeAudioProcessor::AdaptiveMetronomeAudioProcessor()
 // Destructor
 AdaptiveMetronomeAudioProcessor::~AdaptiveMetronomeAudioProcessor() {
 #if JUCE_DEBUG
-    ExportPlayersToCSV();
+    // Only from a plugin wrapper; the offline renderer runs several processors at once
+    if (wrapperType != wrapperType_Undefined)
+        ExportPlayersToCSV();
 #endif
+
+    // The models read the score, so they go first; the score is freed if no other instance has it
+    ensembleWorkers.reset();
+    groupEnsembles.clear();
+    model.reset();
+    floatModel.reset();
+    scoreCache->release(score);
 }
 
 // Called for Audio Playback - Things to be done before audio is played
 void AdaptiveMetronomeAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    
+    // The tempo map's sample positions only need rebuilding when the sample rate changes
+    bool sampleRateChanged = sampleRate != currentSampleRate;
+    bool blockSizeChanged = samplesPerBlock != currentBlockSize;
+    currentBlockSize = samplesPerBlock;
+    if (sampleRateChanged)
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        currentSampleRate = sampleRate;
+        if (!tempoMap.isEmpty())
+            tempoMap.prepare(sampleRate);
+    }
+
+    // Onset times are in samples, so the model follows the sample rate
+    if (getModelSampleRate() != sampleRate)
+        rebuildModel();
+
+    if (sampleRateChanged)
+        rebuildGroupModels();
+
+    // The workers' real-time priority is set from the block length when they start
+    if (ensembleWorkers != nullptr && (sampleRateChanged || blockSizeChanged))
+        setNumEnsembleThreads(numEnsembleThreads);
+
+    // Everything the MIDI output needs is allocated here rather than in processBlock. Preparing
+    // the wheel again would drop its pending note-offs unsent, so a host that prepares again
+    // mid-session has the sounding notes, the group ensembles' too, released next block instead
+    if (noteOffs.getCapacity() != maxSoundingNotes)
+        noteOffs.prepare(maxSoundingNotes);
+    else
+        releaseNotesNextBlock = true;
+    outputMidi.ensureSize((size_t) maxSoundingNotes * 8);
+    midiClock.prepare(sampleRate);
+    transportRunning = false;
 }
 
 // Main Function - Samples inputs through here as this is called continuously throughout playback, 
 void AdaptiveMetronomeAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    RealtimeCheck::ScopedAudioThread audioThread("processBlock");
+    TraceLog::ScopedTrace trace("processBlock", "audio");
+    TraceLog::setThreadName("Audio");
+
+    // The message thread only holds this while swapping in a new score or model
+    // Taps are never passed through, not even in a block the plugin skips
+    const juce::SpinLock::ScopedTryLockType lock(scoreLock);
+    if (!lock.isLocked())
+    {
+        midiMessages.clear();
+        return;
+    }
+
+    int numSamples = buffer.getNumSamples();
+    outputMidi.clear();
+
+    if (releaseNotesNextBlock)
+    {
+        releaseAllNotes(0);
+        stopGroupEnsembles();
+        releaseNotesNextBlock = false;
+    }
+
+    // Calibration takes over the audio and MIDI output until it is done
+    if (latencyCalibrator.isActive())
+    {
+        if (transportRunning)
+        {
+            releaseAllNotes(0);
+            stopGroupEnsembles();
+        }
+
+        transportRunning = false;
+        network.setTransportOrigin(0);
+        discardOscTaps();
+        latencyCalibrator.process(buffer, outputMidi);
+        midiClock.stop();
+        midiClock.process(0, numSamples, outputMidi);
+        midiMessages.clear();
+        midiMessages.addEvents(outputMidi, 0, numSamples, 0);
+        return;
+    }
 
+    if (model == nullptr && floatModel == nullptr)
+    {
+        network.setTransportOrigin(0);
+        discardOscTaps();
+        midiMessages.clear();
+        midiMessages.addEvents(outputMidi, 0, numSamples, 0);
+        return;
+    }
+
+    auto* playHead = getPlayHead();
+    auto position = playHead != nullptr ? playHead->getPosition() : juce::Optional<juce::AudioPlayHead::PositionInfo>();
+    if (!position.hasValue() || !position->getIsPlaying())
+    {
+        if (transportRunning)
+        {
+            releaseAllNotes(0);
+            stopGroupEnsembles();
+        }
+
+        transportRunning = false;
+        network.setTransportOrigin(0);
+        discardOscTaps();
+        midiClock.stop();
+        midiClock.process(0, numSamples, outputMidi);
+        midiMessages.clear();
+        midiMessages.addEvents(outputMidi, 0, numSamples, 0);
+        return;
+    }
+
+    if (floatModel != nullptr)
+        playEnsemble(*floatModel, midiMessages, *position, numSamples);
+    else
+        playEnsemble(*model, midiMessages, *position, numSamples);
+}
+
+// The rest of processBlock while the transport runs: steps the main ensemble, in whichever
+// precision it was built, and plays the group ensembles alongside it
+template <typename Model>
+void AdaptiveMetronomeAudioProcessor::playEnsemble(Model& ensembleModel, juce::MidiBuffer& midiMessages, const juce::AudioPlayHead::PositionInfo& position, int numSamples)
+{
+    // Any discontinuity in the host position (start, seek, loop) relocates the model
+    auto blockStart = position.getTimeInSamples().orFallback(expectedBlockStart);
+    bool relocated = !transportRunning || blockStart != expectedBlockStart || ensembleModel.getNeedsRelocation();
+    if (relocated)
+    {
+        RealtimeCheck::ScopedSection section("relocate");
+        TraceLog::ScopedTrace relocateTrace("relocate", "audio");
+        releaseAllNotes(0);
+        noteOffs.setPosition(blockStart);
+        ensembleModel.relocate((double) blockStart);
+        sampleClock.reset();
+        numHeldRemoteOnsets = 0;
+        numHeldOscTaps = 0;
+        firstOscTapSample = (double) blockStart;
+    }
+
+    transportRunning = true;
+    expectedBlockStart = blockStart + numSamples;
+
+    // The group ensembles go to the workers while this thread plays the main ensemble. They only
+    // read the input MIDI, which is left alone until they have all finished
+    auto playGroupEnsemble = [this, &midiMessages, blockStart, numSamples, relocated](int index)
+        {
+            groupEnsembles.getUnchecked(index)->process(*score, tempoMap, midiMessages, blockStart, numSamples, relocated);
+        };
+
+    bool splitGroupEnsembles = ensembleWorkers != nullptr && ensembleWorkers->shouldSplit(groupEnsembles.size(), numSamples);
+    if (splitGroupEnsembles)
+        ensembleWorkers->begin(groupEnsembles.size(), playGroupEnsemble);
+
+    auto sendOnset = [this, &ensembleModel, blockStart, numSamples](int playerIndex, int onsetIndex, double sendTime)
+        {
+            sendComputerOnset(ensembleModel, playerIndex, onsetIndex, sendTime, blockStart, numSamples);
+        };
+
+    bool networked = network.isRunning();
+    bool oscRunning = oscInput.isRunning();
+    if (networked || oscRunning)
+        sampleClock.update(blockStart, currentSampleRate, NetworkEnsemble::getTimeNs());
+
+    // Peers compare this with their own to tell whether the hosts' transports are in step
+    if (networked)
+        network.setTransportOrigin(sampleClock.sampleToNs(0.0));
+
+    if (networked)
+    {
+        // Each remote onset can let the model step, which can make held onsets for the next one usable
+        for (;;)
+        {
+            int onsetIndex = ensembleModel.getState().onsetIndex;
+            receiveRemoteOnsets(ensembleModel);
+            ensembleModel.advanceTo((double) blockStart, sendOnset);
+            if (ensembleModel.getState().onsetIndex == onsetIndex)
+                break;
+        }
+    }
+
+    // Taps on a remote player's channel are not ours to play
+    auto addUserTap = [this, &ensembleModel, networked, &sendOnset](int channel, double tapTime)
+        {
+            int player = ensembleModel.findPlayer(channel);
+            if (player >= 0 && (remotePlayerMask & (1u << player)) != 0)
+                return;
+
+            ensembleModel.advanceTo(tapTime, sendOnset);
+
+            int onsetIndex = ensembleModel.addUserOnset(channel, tapTime);
+            if (onsetIndex >= 0 && networked)
+                network.sendOnset(channel, onsetIndex, sampleClock.sampleToNs(tapTime));
+        };
+
+    // OSC taps before the end of this block are merged with the MIDI taps in time order
+    if (oscRunning)
+        receiveOscTaps();
+
+    int oscTap = 0;
+    auto addOscTapsBefore = [this, &oscTap, &addUserTap](double time)
+        {
+            for (; oscTap < numHeldOscTaps; ++oscTap)
+            {
+                double tapTime = sampleClock.nsToSample(heldOscTaps[(size_t) oscTap].timeNs);
+                if (tapTime >= time)
+                    return;
+
+                // Tapped before the transport got here, so not for this part of the score
+                if (tapTime < firstOscTapSample)
+                {
+                    oscInput.addIgnoredTap();
+                    continue;
+                }
+
+                addUserTap(heldOscTaps[(size_t) oscTap].midiChannel, tapTime);
+            }
+        };
+
+    // User taps, in sample order
+    for (const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+        if (!message.isNoteOn())
+            continue;
+
+        double tapTime = (double) (blockStart + metadata.samplePosition);
+        addOscTapsBefore(tapTime);
+        addUserTap(message.getChannel(), tapTime);
+    }
+
+    addOscTapsBefore((double) expectedBlockStart);
+    std::copy(heldOscTaps.begin() + oscTap, heldOscTaps.begin() + numHeldOscTaps, heldOscTaps.begin());
+    numHeldOscTaps -= oscTap;
+
+    // A remote player that has not been heard from well past its predicted onset is played by its prediction
+    if (networked)
+    {
+        double timeout = ((double) network.getPlayoutDelayNs() * 1.0e-9 + remoteOnsetTimeoutMs * 0.001) * currentSampleRate;
+        for (int i = 0; i < ensembleModel.getNumPlayers(); ++i)
+        {
+            if ((remotePlayerMask & (1u << i)) != 0 && ensembleModel.isWaitingFor(i)
+                && ensembleModel.getOnset(i) + timeout < (double) expectedBlockStart)
+            {
+                ensembleModel.skipUserOnset(i);
+                network.addTimedOutOnset();
+            }
+        }
+    }
+
+    ensembleModel.advanceTo((double) expectedBlockStart, sendOnset);
+
+    // Where the ensemble is at the start of this block, for the MIDI clock and the editor's overview
+    double onsetTime, quarterNotes, samplesPerQuarter;
+    getEnsembleOnset(ensembleModel, onsetTime, quarterNotes, samplesPerQuarter);
+    auto blockPosition = quarterNotes + ((double) blockStart - onsetTime) / samplesPerQuarter;
+    ensemblePosition.store(blockPosition, std::memory_order_relaxed);
+
+    // The clock restarts from wherever the ensemble now is, and when it is switched on. Located
+    // after the advance, the first block's onsets are already scheduled, so a start at the top
+    // of the score finds the ensemble on its first sixteenth
+    if (midiClockEnabled && (relocated || !midiClock.isRunning()))
+        midiClock.locate((double) blockStart, blockPosition, samplesPerQuarter);
+    else if (midiClockEnabled && ensembleModel.getState().onsetIndex != midiClockOnsetIndex)
+        midiClock.follow(onsetTime, quarterNotes, samplesPerQuarter);
+
+    midiClockOnsetIndex = ensembleModel.getState().onsetIndex;
+
+    midiClock.process(blockStart, numSamples, outputMidi);
+
+    noteOffs.advance(expectedBlockStart, [this, blockStart](juce::int64 time, int channel, int noteNumber)
+        {
+            outputMidi.addEvent(juce::MidiMessage::noteOff(channel, noteNumber), (int) juce::jmax((juce::int64) 0, time - blockStart));
+        });
+
+    if (splitGroupEnsembles)
+    {
+        TraceLog::ScopedTrace joinTrace("joinGroupEnsembles", "audio");
+        ensembleWorkers->finish();
+    }
+    else
+    {
+        for (int i = 0; i < groupEnsembles.size(); ++i)
+            playGroupEnsemble(i);
+    }
+
+    // In ensemble order whichever thread played them, so the output does not depend on the workers
+    for (auto* ensemble : groupEnsembles)
+        outputMidi.addEvents(ensemble->getOutput(), 0, numSamples, 0);
+
+    // The output carries only the computer players - user taps are not passed through.
+    // Copied rather than swapped so outputMidi keeps the storage reserved in prepareToPlay
+    midiMessages.clear();
+    midiMessages.addEvents(outputMidi, 0, numSamples, 0);
+}
+
+// Sends a computer player's notes for a score onset and schedules their note-offs (see ComputerNotes)
+template <typename Model>
+void AdaptiveMetronomeAudioProcessor::sendComputerOnset(const Model& ensembleModel, int playerIndex, int onsetIndex, double sendTime, juce::int64 blockStart, int numSamples)
+{
+    const auto& player = ensembleModel.getPlayer(playerIndex);
+    double stretch = ensembleModel.getPeriod(playerIndex) / ensembleModel.getReferencePeriod();
+
+    auto sendSample = ComputerNotes::send(*score, tempoMap, player, 0, stretch, onsetIndex, sendTime, blockStart, numSamples, noteOffs, outputMidi);
+    schedulingStatistics.addComputerOnset((double) (sendSample - (juce::int64) std::floor(sendTime)) * 1000.0 / currentSampleRate);
+
+    // Peers get the onset itself, not the send time that makes up for this player's output latency
+    if (network.isRunning())
+        network.sendOnset(player.getMidiChannel(), onsetIndex, sampleClock.sampleToNs(ensembleModel.getOnset(playerIndex)));
+}
+
+// Applies the remote onsets for the score onset the model is on, holds those for later ones
+// and drops those that arrived after the model gave up on them
+template <typename Model>
+void AdaptiveMetronomeAudioProcessor::receiveRemoteOnsets(Model& ensembleModel)
+{
+    network.popOnsets([this](const NetworkOnset& onset)
+        {
+            if (numHeldRemoteOnsets < maxHeldRemoteOnsets)
+                heldRemoteOnsets[(size_t) numHeldRemoteOnsets++] = onset;
+            else
+                network.addLateOnset();
+        });
+
+    int numKept = 0;
+    for (int i = 0; i < numHeldRemoteOnsets; ++i)
+    {
+        const auto& onset = heldRemoteOnsets[(size_t) i];
+        int player = ensembleModel.findPlayer(onset.midiChannel);
+        if (player < 0 || (remotePlayerMask & (1u << player)) == 0)
+            continue;
+
+        int onsetIndex = ensembleModel.getState().onsetIndex;
+        if (onset.onsetIndex > onsetIndex)
+        {
+            heldRemoteOnsets[(size_t) numKept++] = onset;
+            continue;
+        }
+
+        if (ensembleModel.addRemoteOnset(player, onset.onsetIndex, sampleClock.nsToSample(onset.timeNs)))
+            network.addCorrectionLatency((double) (NetworkEnsemble::getTimeNs() - onset.timeNs) * 1.0e-6);
+        else
+            network.addLateOnset();
+    }
+
+    numHeldRemoteOnsets = numKept;
+}
+
+// Takes the taps the OSC thread has queued, keeping them in time order. Bundled taps can be
+// stamped ahead of when they arrive, so they wait here until the host reaches them
+void AdaptiveMetronomeAudioProcessor::receiveOscTaps()
+{
+    oscInput.popTaps([this](const ExternalTap& tap)
+        {
+            if (numHeldOscTaps == maxHeldOscTaps)
+            {
+                oscInput.addDroppedTap();
+                return;
+            }
+
+            int position = numHeldOscTaps++;
+            while (position > 0 && heldOscTaps[(size_t) position - 1].timeNs > tap.timeNs)
+            {
+                heldOscTaps[(size_t) position] = heldOscTaps[(size_t) position - 1];
+                --position;
+            }
+            heldOscTaps[(size_t) position] = tap;
+        });
+}
+
+// While nothing is playing, OSC taps are thrown away as MIDI taps are, held ones included
+void AdaptiveMetronomeAudioProcessor::discardOscTaps()
+{
+    oscInput.discardTaps();
+    for (int i = 0; i < numHeldOscTaps; ++i)
+        oscInput.addIgnoredTap();
+    numHeldOscTaps = 0;
+}
+
+// Ends every sounding computer note at the given offset into the block
+void AdaptiveMetronomeAudioProcessor::releaseAllNotes(int sampleOffset)
+{
+    ComputerNotes::releaseAll(noteOffs, outputMidi, sampleOffset);
+}
+
+// Ends the group ensembles' sounding notes at the start of the block
+void AdaptiveMetronomeAudioProcessor::stopGroupEnsembles()
+{
+    for (auto* ensemble : groupEnsembles)
+    {
+        ensemble->stop();
+        outputMidi.addEvents(ensemble->getOutput(), 0, 1, 0);
+    }
 }
 
 // This function is called during prepareToPlay() to update the Player's parameters base on the GUI
 void AdaptiveMetronomeAudioProcessor::UpdatePlayers(juce::Array<Player> newPlayers)
 {
     players = newPlayers;
+    rebuildModel();
+}
+
+// Compiles a MIDI file, or shares another instance's copy of it, and hands it to the audio thread.
+// Called from the editor's Load MIDI button
+bool AdaptiveMetronomeAudioProcessor::loadScore(const juce::File& midiFile)
+{
+    RealtimeCheck::noteBlockingCall("loadScore");
+    TraceLog::ScopedTrace trace("loadScore", "score");
+
+    CompiledScore::Ptr newScore = scoreCache->acquire(midiFile, chordToleranceMs);
+    if (newScore == nullptr)
+    {
+        DBG("Failed to load MIDI file " + midiFile.getFullPathName());
+        return false;
+    }
+
+    // Prepare the tempo map and model before taking the lock so the swap itself is cheap
+    TempoMap newTempoMap = newScore->tempoMap;
+    if (currentSampleRate > 0.0)
+        newTempoMap.prepare(currentSampleRate);
+
+    std::unique_ptr<EnsembleModel> newModel;
+    std::unique_ptr<FloatEnsembleModel> newFloatModel;
+    createModel(newScore.get(), newTempoMap, newModel, newFloatModel);
+
+    // The group ensembles' models read the score too, so they are swapped with it
+    std::vector<std::unique_ptr<EnsembleModel>> newGroupModels;
+    for (auto* ensemble : groupEnsembles)
+        newGroupModels.push_back(ensemble->createModel(newScore.get(), newTempoMap, predictiveScheduling));
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        std::swap(score, newScore);
+        std::swap(tempoMap, newTempoMap);
+        std::swap(model, newModel);
+        std::swap(floatModel, newFloatModel);
+        for (int i = 0; i < groupEnsembles.size(); ++i)
+            groupEnsembles[i]->swapModel(newGroupModels[(size_t) i]);
+        asynchronyStatistics.reset();
+        schedulingStatistics.reset();
+    }
+
+    scoreFile = midiFile;
+
+    // The previous models and score are released here, on the message thread
+    newModel.reset();
+    newFloatModel.reset();
+    newGroupModels.clear();
+    scoreCache->release(newScore);
+
+    DBG("Loaded score with " + juce::String(score->getNumOnsets()) + " onsets");
+    return true;
+}
+
+// Builds the model for the given score and the current players, in the precision chosen with
+// setSinglePrecisionModel(). Both are left nullptr if there is nothing to play yet
+void AdaptiveMetronomeAudioProcessor::createModel(const CompiledScore* compiledScore, const TempoMap& preparedTempoMap,
+                                                   std::unique_ptr<EnsembleModel>& newModel, std::unique_ptr<FloatEnsembleModel>& newFloatModel)
+{
+    if (singlePrecisionModel)
+        newFloatModel = createModel<FloatEnsembleModel>(compiledScore, preparedTempoMap);
+    else
+        newModel = createModel<EnsembleModel>(compiledScore, preparedTempoMap);
+}
+
+template <typename Model>
+std::unique_ptr<Model> AdaptiveMetronomeAudioProcessor::createModel(const CompiledScore* compiledScore, const TempoMap& preparedTempoMap)
+{
+    if (compiledScore == nullptr || compiledScore->getNumOnsets() == 0 || players.size() == 0 || preparedTempoMap.getSampleRate() <= 0.0)
+        return nullptr;
+
+    // Players on other instances are waited for like user players
+    auto ensemblePlayers = players;
+    for (int i = 0; i < ensemblePlayers.size(); ++i)
+        if ((remotePlayerMask & (1u << i)) != 0)
+            ensemblePlayers.getReference(i).setIsUser(true);
+
+    auto newModel = std::make_unique<Model>(*compiledScore, preparedTempoMap, ensemblePlayers);
+    newModel->setStatistics(&asynchronyStatistics);
+    newModel->setOnsetFifo(&onsetFifo);
+    newModel->setSchedulingStatistics(&schedulingStatistics);
+    newModel->setPredictive(predictiveScheduling);
+    return newModel;
+}
+
+// The ensemble at the model's current onset: the players' mean onset time, the score position
+// there in quarter notes, and the players' mean period scaled from the model's reference beat to
+// the score's quarter note at that point
+template <typename Model>
+void AdaptiveMetronomeAudioProcessor::getEnsembleOnset(const Model& ensembleModel, double& onsetTime, double& quarterNotes, double& samplesPerQuarter) const
+{
+    double onsetSum = 0.0, periodSum = 0.0;
+    for (int i = 0; i < ensembleModel.getNumPlayers(); ++i)
+    {
+        onsetSum += ensembleModel.getOnset(i);
+        periodSum += ensembleModel.getPeriod(i);
+    }
+
+    auto numPlayers = (double) ensembleModel.getNumPlayers();
+    auto tick = score->onsets[(size_t) ensembleModel.getState().onsetIndex].tick;
+    onsetTime = onsetSum / numPlayers;
+    quarterNotes = score->tempoMap.tickToBeats(tick);
+    samplesPerQuarter = periodSum / numPlayers / ensembleModel.getReferencePeriod() * tempoMap.getSecondsPerQuarterNoteAt(tick) * currentSampleRate;
+}
+
+// Switches the MIDI clock output on or off. It starts with the transport, or at once if it is already running
+void AdaptiveMetronomeAudioProcessor::setMidiClockEnabled(bool shouldBeEnabled)
+{
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    midiClockEnabled = shouldBeEnabled;
+    if (!shouldBeEnabled)
+        midiClock.stop();
+}
+
+// Replaces the model after the players or sample rate change. The checkpoint simulation runs here, off the audio thread
+void AdaptiveMetronomeAudioProcessor::rebuildModel()
+{
+    RealtimeCheck::noteBlockingCall("rebuildModel");
+    TraceLog::ScopedTrace trace("rebuildModel", "score");
+
+    std::unique_ptr<EnsembleModel> newModel;
+    std::unique_ptr<FloatEnsembleModel> newFloatModel;
+    createModel(score.get(), tempoMap, newModel, newFloatModel);
+
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    std::swap(model, newModel);
+    std::swap(floatModel, newFloatModel);
+}
+
+// The sample rate the model was built for, or 0 without one
+double AdaptiveMetronomeAudioProcessor::getModelSampleRate() const
+{
+    if (floatModel != nullptr)
+        return floatModel->getSampleRate();
+    return model != nullptr ? model->getSampleRate() : 0.0;
+}
+
+// Replaces every group ensemble's model after the sample rate changes
+void AdaptiveMetronomeAudioProcessor::rebuildGroupModels()
+{
+    RealtimeCheck::noteBlockingCall("rebuildGroupModels");
+
+    std::vector<std::unique_ptr<EnsembleModel>> newGroupModels;
+    for (auto* ensemble : groupEnsembles)
+        newGroupModels.push_back(ensemble->createModel(score.get(), tempoMap, predictiveScheduling));
+
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    for (int i = 0; i < groupEnsembles.size(); ++i)
+        groupEnsembles[i]->swapModel(newGroupModels[(size_t) i]);
+}
+
+// Adds an ensemble of its own players, given its model and room for its notes before the audio thread sees it.
+// Returns its index, or -1 if any of its channels is another ensemble's, as their taps and notes would mix
+int AdaptiveMetronomeAudioProcessor::addGroupEnsemble(const juce::Array<Player>& ensemblePlayers, int channelOffset)
+{
+    RealtimeCheck::noteBlockingCall("addGroupEnsemble");
+    TraceLog::ScopedTrace trace("addGroupEnsemble", "score");
+
+    auto channels = GroupEnsemble::getChannelMask(ensemblePlayers, channelOffset);
+    if (channels == 0 || (channels & getChannelsInUse()) != 0)
+        return -1;
+
+    auto ensemble = std::make_unique<GroupEnsemble>(ensemblePlayers, channelOffset, (juce::uint64) groupEnsembles.size() + 2);
+    ensemble->prepare(maxSoundingNotes);
+    auto newModel = ensemble->createModel(score.get(), tempoMap, predictiveScheduling);
+    ensemble->swapModel(newModel);
+
+    if (numEnsembleThreads < 0)
+        setNumEnsembleThreads(defaultEnsembleThreads);
+
+    // The output grows to hold every ensemble's notes. The audio thread writes to it, so the larger
+    // buffer is allocated here and swapped in, and the smaller one freed after the lock
+    juce::MidiBuffer newOutputMidi;
+    newOutputMidi.ensureSize((size_t) maxSoundingNotes * 8 * (size_t) (groupEnsembles.size() + 2));
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        outputMidi.swapWith(newOutputMidi);
+        groupEnsembles.add(ensemble.release());
+    }
+
+    return groupEnsembles.size() - 1;
+}
+
+void AdaptiveMetronomeAudioProcessor::removeGroupEnsemble(int index)
+{
+    std::unique_ptr<GroupEnsemble> removed;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        removed.reset(groupEnsembles.removeAndReturn(index));
+    }
+}
+
+// The main ensemble's players' channels as they are now, and every group ensemble's
+juce::uint32 AdaptiveMetronomeAudioProcessor::getChannelsInUse() const
+{
+    juce::uint32 channels = 0;
+    for (const auto& player : players)
+        if (player.getMidiChannel() >= 1 && player.getMidiChannel() <= 16)
+            channels |= 1u << (player.getMidiChannel() - 1);
+
+    for (auto* ensemble : groupEnsembles)
+        channels |= ensemble->getChannelMask();
+
+    return channels;
+}
+
+int AdaptiveMetronomeAudioProcessor::findFreeChannelOffset(const juce::Array<Player>& ensemblePlayers) const
+{
+    auto channelsInUse = getChannelsInUse();
+    for (int step = 1; step < 16; ++step)
+    {
+        for (int offset : { step, -step })
+        {
+            auto channels = GroupEnsemble::getChannelMask(ensemblePlayers, offset);
+            if (channels != 0 && (channels & channelsInUse) == 0)
+                return offset;
+        }
+    }
+
+    return noFreeChannelOffset;
+}
+
+// Starts the new workers before taking the lock and stops the old ones after, so the audio
+// thread only misses the swap itself. A core is left for the audio thread, as workers spin
+void AdaptiveMetronomeAudioProcessor::setNumEnsembleThreads(int numThreads)
+{
+    numEnsembleThreads = juce::jlimit(0, juce::jmin(EnsembleWorkers::maxThreads, juce::SystemStats::getNumCpus() - 1), numThreads);
+
+    std::unique_ptr<EnsembleWorkers> newWorkers;
+    if (numEnsembleThreads > 0)
+    {
+        newWorkers = std::make_unique<EnsembleWorkers>();
+        newWorkers->start(numEnsembleThreads, currentSampleRate > 0.0 ? currentSampleRate : 48000.0, currentBlockSize);
+    }
+
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    std::swap(ensembleWorkers, newWorkers);
+}
+
+// Joins the instances at peerAddresses ("host:port"). The model is rebuilt to wait for the remote players
+bool AdaptiveMetronomeAudioProcessor::startNetwork(int localPort, const juce::StringArray& peerAddresses, juce::uint32 remoteMask)
+{
+    if (!network.start(localPort, peerAddresses))
+        return false;
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        remotePlayerMask = remoteMask;
+    }
+
+    rebuildModel();
+    return true;
+}
+
+void AdaptiveMetronomeAudioProcessor::stopNetwork()
+{
+    network.stop();
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        remotePlayerMask = 0;
+    }
+
+    rebuildModel();
+}
+
+// Switches between stepping on the users' predicted onsets and waiting for their taps
+void AdaptiveMetronomeAudioProcessor::setPredictiveScheduling(bool shouldPredict)
+{
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    predictiveScheduling = shouldPredict;
+    if (model != nullptr)
+        model->setPredictive(shouldPredict);
+    if (floatModel != nullptr)
+        floatModel->setPredictive(shouldPredict);
+    for (auto* ensemble : groupEnsembles)
+        ensemble->setPredictive(shouldPredict);
+    schedulingStatistics.reset();
+}
+
+// Plays the main ensemble on FloatEnsembleModel instead of the double model. Meant for batch
+// rendering; the group ensembles stay double
+void AdaptiveMetronomeAudioProcessor::setSinglePrecisionModel(bool shouldUseFloat)
+{
+    singlePrecisionModel = shouldUseFloat;
+    rebuildModel();
+}
+
+// Measures the computer players among playersToMeasure at the current sample rate
+bool AdaptiveMetronomeAudioProcessor::startLatencyCalibration(const juce::Array<Player>& playersToMeasure, const LatencyCalibrator::Settings& settings)
+{
+    if (currentSampleRate <= 0.0)
+        return false;
+
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    return latencyCalibrator.start(settings, playersToMeasure, currentSampleRate);
+}
+
+void AdaptiveMetronomeAudioProcessor::cancelLatencyCalibration()
+{
+    const juce::SpinLock::ScopedLockType lock(scoreLock);
+    latencyCalibrator.clear();
+}
+
+// Sets the delay of every player that was measured and hands the players to the model. The
+// players are taken as they are now, so edits made while the calibration ran are kept
+bool AdaptiveMetronomeAudioProcessor::applyLatencyCalibration(juce::Array<Player> currentPlayers)
+{
+    if (!latencyCalibrator.isFinished())
+        return false;
+
+    const auto& results = latencyCalibrator.getResults();
+    bool anyMeasured = false;
+    for (int i = 0; i < juce::jmin(currentPlayers.size(), LatencyCalibrator::maxPlayers); ++i)
+    {
+        if (!results[(size_t) i].measured)
+            continue;
+
+        currentPlayers.getReference(i).setDelay((float) results[(size_t) i].delayMs);
+        anyMeasured = true;
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(scoreLock);
+        latencyCalibrator.clear();
+    }
+
+    if (anyMeasured)
+        UpdatePlayers(currentPlayers);
+
+    return anyMeasured;
 }
 
 // Debug function used to see if players have been successfully stored in the processor for the ensembleModel
 void AdaptiveMetronomeAudioProcessor::ExportPlayersToCSV()
 {
+    RealtimeCheck::noteBlockingCall("ExportPlayersToCSV");
+    TraceLog::ScopedTrace trace("ExportPlayersToCSV", "logging");
+
     juce::File file("D:/players_export.csv");
 
     // Delete the file if it already exists (recreate it)
@@ -109,20 +841,75 @@ void AdaptiveMetronomeAudioProcessor::releaseResources()
 //==============================================================================
 #pragma region State Handling
 
+namespace
+{
+    void addPlayerXml(juce::XmlElement& parent, const Player& player)
+    {
+        auto* xml = parent.createNewChildElement("Player");
+        xml->setAttribute("id", player.getId());
+        xml->setAttribute("isUser", player.getIsUser() ? 1 : 0);
+        xml->setAttribute("midiChannel", player.getMidiChannel());
+        xml->setAttribute("volume", (double) player.getVolume());
+        xml->setAttribute("delay", (double) player.getDelay());
+        xml->setAttribute("motorNoiseSTD", (double) player.getMotorNoiseSTD());
+        xml->setAttribute("timeKeeperNoiseSTD", (double) player.getTimeKeeperNoiseSTD());
+        for (int i = 0; i < 4; ++i)
+        {
+            xml->setAttribute("alpha" + juce::String(i + 1), player.getAlphas()[(size_t) i]);
+            xml->setAttribute("beta" + juce::String(i + 1), player.getBetas()[(size_t) i]);
+        }
+    }
+
+    Player playerFromXml(const juce::XmlElement& xml)
+    {
+        std::array<double, 4> alphas, betas;
+        for (int i = 0; i < 4; ++i)
+        {
+            alphas[(size_t) i] = xml.getDoubleAttribute("alpha" + juce::String(i + 1));
+            betas[(size_t) i] = xml.getDoubleAttribute("beta" + juce::String(i + 1));
+        }
+
+        return Player(xml.getIntAttribute("id"), xml.getBoolAttribute("isUser"), xml.getIntAttribute("midiChannel"),
+                      (float) xml.getDoubleAttribute("volume"), (float) xml.getDoubleAttribute("delay"),
+                      (float) xml.getDoubleAttribute("motorNoiseSTD"), (float) xml.getDoubleAttribute("timeKeeperNoiseSTD"),
+                      alphas, betas);
+    }
+}
 
-// Calls when a project is saved
+// Calls when a project is saved. Holds the group ensembles; the main ensemble's players come from the editor
 void AdaptiveMetronomeAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    juce::XmlElement state("AdaptiveMetronome");
+    for (auto* ensemble : groupEnsembles)
+    {
+        auto* ensembleXml = state.createNewChildElement("GroupEnsemble");
+        ensembleXml->setAttribute("channelOffset", ensemble->getChannelOffset());
+        for (const auto& player : ensemble->getPlayers())
+            addPlayerXml(*ensembleXml, player);
+    }
+
+    copyXmlToBinary(state, destData);
 }
 
-// Used to load saved information in the state
+// Used to load saved information in the state. The group ensembles replace any there are, in their saved order
 void AdaptiveMetronomeAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    auto state = getXmlFromBinary(data, sizeInBytes);
+    if (state == nullptr || !state->hasTagName("AdaptiveMetronome"))
+        return;
+
+    while (groupEnsembles.size() > 0)
+        removeGroupEnsemble(groupEnsembles.size() - 1);
+
+    for (auto* ensembleXml : state->getChildWithTagNameIterator("GroupEnsemble"))
+    {
+        juce::Array<Player> ensemblePlayers;
+        for (auto* playerXml : ensembleXml->getChildWithTagNameIterator("Player"))
+            ensemblePlayers.add(playerFromXml(*playerXml));
+
+        if (addGroupEnsemble(ensemblePlayers, ensembleXml->getIntAttribute("channelOffset")) < 0)
+            DBG("A saved group ensemble's channels are taken, so it was left out");
+    }
 }
 #pragma endregion Functions Related to handling closeing and opening projects with the plugin
 //==============================================================================
@@ -9,7 +9,20 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "AsynchronyStatistics.h"
 #include "Player.h"
+#include "EnsembleModel.h"
+#include "EnsembleWorkers.h"
+#include "GroupEnsemble.h"
+#include "LatencyCalibrator.h"
+#include "MidiClock.h"
+#include "NetworkEnsemble.h"
+#include "NoteOffWheel.h"
+#include "OscInput.h"
+#include "OnsetFifo.h"
+#include "Score.h"
+#include "ScoreCache.h"
+#include "TempoMap.h"
 
 //==============================================================================
 /**
@@ -38,6 +51,72 @@ public:
     void UpdatePlayers(juce::Array<Player> newPlayers);
     void ExportPlayersToCSV();
 
+    // Score handling
+    bool loadScore(const juce::File& midiFile);
+    bool hasScore() const { return score != nullptr; }
+    const juce::File& getScoreFile() const { return scoreFile; }
+
+    // The loaded score's piano-roll overview, or nullptr while it is still being built. Message thread
+    ScoreOverview::Ptr getScoreOverview() const { return score != nullptr ? scoreCache->getOverview(*score) : nullptr; }
+
+    // The ensemble's score position in quarter notes, as of the last block played
+    double getEnsemblePosition() const { return ensemblePosition.load(std::memory_order_relaxed); }
+    void setChordToleranceMs(double newToleranceMs) { chordToleranceMs = newToleranceMs; }  // Applies to the next score loaded
+
+    // Live synchrony metrics - safe to read from the editor or an OSC sender at any time
+    const AsynchronyStatistics& getAsynchronyStatistics() const { return asynchronyStatistics; }
+
+    // Prediction error and computer onset lateness, to compare predictive and reactive scheduling
+    const SchedulingStatistics& getSchedulingStatistics() const { return schedulingStatistics; }
+    void setPredictiveScheduling(bool shouldPredict);
+    bool isPredictiveScheduling() const { return predictiveScheduling; }
+
+    // The main ensemble in float rather than double, for the offline renderer's --float
+    void setSinglePrecisionModel(bool shouldUseFloat);
+    bool isSinglePrecisionModel() const { return singlePrecisionModel; }
+
+    // Every onset the ensemble plays, for the editor's monitor - read by one consumer only
+    OnsetFifo& getOnsetFifo() { return onsetFifo; }
+
+    // Networked ensemble - the players in remoteMask (bit per player) are played on other instances
+    bool startNetwork(int localPort, const juce::StringArray& peerAddresses, juce::uint32 remoteMask);
+    void stopNetwork();
+    NetworkEnsemble& getNetwork() { return network; }
+    juce::uint32 getRemotePlayerMask() const { return remotePlayerMask; }
+
+    // Taps from OSC devices, played exactly like MIDI taps
+    bool startOscInput(int port) { return oscInput.start(port); }
+    void stopOscInput() { oscInput.stop(); }
+    OscInput& getOscInput() { return oscInput; }
+
+    // Latency calibration - plays clicks and listens for them on the input, then sets each computer
+    // player's delay. The ensemble is silent while it runs
+    bool startLatencyCalibration(const juce::Array<Player>& playersToMeasure, const LatencyCalibrator::Settings& settings);
+    void cancelLatencyCalibration();
+    const LatencyCalibrator& getLatencyCalibrator() const { return latencyCalibrator; }
+    bool applyLatencyCalibration(juce::Array<Player> currentPlayers);     // Once finished: the players with their measured delays
+
+    // 24 ppqn MIDI clock with start/stop/song position on the MIDI output, following the ensemble's tempo
+    void setMidiClockEnabled(bool shouldBeEnabled);
+    bool isMidiClockEnabled() const { return midiClockEnabled; }
+    const MidiClock& getMidiClock() const { return midiClock; }
+
+    // Further ensembles for group experiments, each with its own players, playing the same score
+    // next to the main ensemble. Taps and notes are channelOffset channels up or down from the
+    // players' own, to keep the ensembles apart. Message thread. An ensemble removed while the
+    // transport runs leaves its sounding notes to the host. Saved with the plugin's state
+    int addGroupEnsemble(const juce::Array<Player>& ensemblePlayers, int channelOffset);   // -1 if its channels are taken or outside 1-16
+    void removeGroupEnsemble(int index);
+    int getNumGroupEnsembles() const { return groupEnsembles.size(); }
+    const GroupEnsemble& getGroupEnsemble(int index) const { return *groupEnsembles[index]; }
+    juce::uint32 getChannelsInUse() const;                                  // Bit n - 1 for channel n, by any ensemble
+    int findFreeChannelOffset(const juce::Array<Player>& ensemblePlayers) const;   // The nearest that fits, up or down, or noFreeChannelOffset
+    static constexpr int noFreeChannelOffset = 0;                           // The main ensemble's own channels
+
+    // Worker threads the group ensembles are spread over each block, next to the audio thread.
+    // 0 plays them all on the audio thread. Until set, the first group ensemble starts a default
+    void setNumEnsembleThreads(int numThreads);
+    int getNumEnsembleThreads() const { return ensembleWorkers != nullptr ? ensembleWorkers->getNumThreads() : 0; }
 
 
 
@@ -77,6 +156,77 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
 
 private:
+    void createModel(const CompiledScore* compiledScore, const TempoMap& preparedTempoMap,
+                     std::unique_ptr<EnsembleModel>& newModel, std::unique_ptr<FloatEnsembleModel>& newFloatModel);
+    template <typename Model>
+    std::unique_ptr<Model> createModel(const CompiledScore* compiledScore, const TempoMap& preparedTempoMap);
+    void rebuildModel();
+    double getModelSampleRate() const;
+    template <typename Model>
+    void playEnsemble(Model& ensembleModel, juce::MidiBuffer& midiMessages, const juce::AudioPlayHead::PositionInfo& position, int numSamples);
+    template <typename Model>
+    void sendComputerOnset(const Model& ensembleModel, int playerIndex, int onsetIndex, double sendTime, juce::int64 blockStart, int numSamples);
+    void releaseAllNotes(int sampleOffset);
+    template <typename Model>
+    void receiveRemoteOnsets(Model& ensembleModel);
+    void receiveOscTaps();
+    void discardOscTaps();
+    template <typename Model>
+    void getEnsembleOnset(const Model& ensembleModel, double& onsetTime, double& quarterNotes, double& samplesPerQuarter) const;
+    void rebuildGroupModels();
+    void stopGroupEnsembles();
+
+    juce::SharedResourcePointer<ScoreCache> scoreCache;    // Shared by every instance in the process
+    CompiledScore::Ptr score;       // From scoreCache on the message thread, read by processBlock
+    juce::File scoreFile;
+    TempoMap tempoMap;              // This instance's copy of the score's tempo map, prepared at currentSampleRate
+    juce::SpinLock scoreLock;       // Guards swapping score/tempoMap while the audio thread is using them
+    double currentSampleRate = 0.0;
+    int currentBlockSize = 512;
+    double chordToleranceMs = ScoreCompiler::defaultChordToleranceMs;
+
+    std::unique_ptr<EnsembleModel> model;   // Swapped under scoreLock whenever the score, players or sample rate change
+    std::unique_ptr<FloatEnsembleModel> floatModel;     // In place of model when singlePrecisionModel is set
+    bool singlePrecisionModel = false;
+    bool transportRunning = false;
+    bool releaseNotesNextBlock = false;     // Set by prepareToPlay, which hosts do not call during processBlock
+    juce::int64 expectedBlockStart = 0;     // Where the host should be next block if it did not jump
+
+    static constexpr int maxSoundingNotes = 8192;
+    NoteOffWheel noteOffs;                  // Pending note-offs of the computer players
+    juce::MidiBuffer outputMidi;            // Built each block, then copied into the host's buffer
+
+    AsynchronyStatistics asynchronyStatistics;  // Written by the audio thread only, except reset under scoreLock
+    SchedulingStatistics schedulingStatistics;  // Likewise
+    bool predictiveScheduling = true;           // Changed under scoreLock
+    OnsetFifo onsetFifo;
+
+    NetworkEnsemble network;
+    SampleClock sampleClock;                // Host samples to the local clock the network uses
+    juce::uint32 remotePlayerMask = 0;      // Changed under scoreLock, with the model rebuilt
+    static constexpr int maxHeldRemoteOnsets = 64;
+    static constexpr double remoteOnsetTimeoutMs = 150.0;   // Past the playout delay, before a remote player is predicted instead
+    std::array<NetworkOnset, maxHeldRemoteOnsets> heldRemoteOnsets;  // Delivered ahead of the onset the model is on
+    int numHeldRemoteOnsets = 0;
+
+    OscInput oscInput;
+    static constexpr int maxHeldOscTaps = 256;
+    std::array<ExternalTap, maxHeldOscTaps> heldOscTaps;    // Received, in time order, not yet reached by the host
+    int numHeldOscTaps = 0;
+    double firstOscTapSample = 0.0;         // Earlier taps were made before the last relocation
+
+    MidiClock midiClock;
+    bool midiClockEnabled = false;          // Changed under scoreLock
+    int midiClockOnsetIndex = -1;           // The model onset the clock last followed
+    std::atomic<double> ensemblePosition { 0.0 };
+
+    juce::OwnedArray<GroupEnsemble> groupEnsembles;         // Added, removed and given models under scoreLock
+    std::unique_ptr<EnsembleWorkers> ensembleWorkers;       // Swapped under scoreLock, nullptr to play serially
+    int numEnsembleThreads = -1;                            // -1 until chosen
+    static constexpr int defaultEnsembleThreads = 3;
+
+    LatencyCalibrator latencyCalibrator;    // Started and stopped under scoreLock
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AdaptiveMetronomeAudioProcessor)
 };
@@ -0,0 +1,349 @@
+#include "RealtimeCheck.h"
+#include "PluginProcessor.h"
+#include "Score.h"
+#include "TempoMap.h"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+ #include <intrin.h>
+ #include <malloc.h>
+ #define REALTIME_CHECK_CALLER() _ReturnAddress()
+#else
+ #define REALTIME_CHECK_CALLER() __builtin_return_address(0)
+#endif
+
+namespace RealtimeCheck
+{
+    namespace
+    {
+        constexpr int maxSectionDepth = 8;
+
+        // Plain data only, so creating it never allocates
+        struct ThreadState
+        {
+            int audioThreadDepth = 0;
+            int sectionDepth = 0;
+            const char* sections[maxSectionDepth] = {};
+            bool isRecording = false;   // Stops allocations made while reporting from being reported
+        };
+
+        thread_local ThreadState threadState;
+
+        std::array<Violation, maxRecordedViolations> violations;
+        std::atomic<int> numViolations { 0 };
+        std::atomic<bool> assertOnViolation { true };
+
+        void pushSection(const char* sectionName)
+        {
+            if (threadState.sectionDepth < maxSectionDepth)
+                threadState.sections[threadState.sectionDepth] = sectionName;
+            ++threadState.sectionDepth;
+        }
+
+        void popSection()
+        {
+            --threadState.sectionDepth;
+        }
+
+        const char* getSection(int levelsUp)
+        {
+            int index = juce::jmin(threadState.sectionDepth, maxSectionDepth) - 1 - levelsUp;
+            return index >= 0 ? threadState.sections[index] : nullptr;
+        }
+
+        void record(ViolationType type, size_t size, const char* what, const void* caller)
+        {
+            if (threadState.audioThreadDepth == 0 || threadState.isRecording)
+                return;
+
+            threadState.isRecording = true;
+
+            int index = numViolations.fetch_add(1);
+            if (index < maxRecordedViolations)
+                violations[(size_t) index] = { type, size, getSection(0), getSection(1), what, caller };
+
+            if (assertOnViolation.load())
+                jassertfalse; // Real-time violation - see RealtimeCheck::getViolation() for where
+
+            threadState.isRecording = false;
+        }
+    }
+
+    ScopedAudioThread::ScopedAudioThread(const char* sectionName)
+    {
+       #if ADAPTIVE_METRONOME_REALTIME_CHECKS
+        ++threadState.audioThreadDepth;
+        pushSection(sectionName);
+       #else
+        juce::ignoreUnused(sectionName);
+       #endif
+    }
+
+    ScopedAudioThread::~ScopedAudioThread()
+    {
+       #if ADAPTIVE_METRONOME_REALTIME_CHECKS
+        popSection();
+        --threadState.audioThreadDepth;
+       #endif
+    }
+
+    ScopedSection::ScopedSection(const char* sectionName)
+    {
+       #if ADAPTIVE_METRONOME_REALTIME_CHECKS
+        pushSection(sectionName);
+       #else
+        juce::ignoreUnused(sectionName);
+       #endif
+    }
+
+    ScopedSection::~ScopedSection()
+    {
+       #if ADAPTIVE_METRONOME_REALTIME_CHECKS
+        popSection();
+       #endif
+    }
+
+    bool isAudioThread()
+    {
+        return threadState.audioThreadDepth > 0;
+    }
+
+    void noteBlockingCall(const char* what)
+    {
+       #if ADAPTIVE_METRONOME_REALTIME_CHECKS
+        record(ViolationType::blockingCall, 0, what, REALTIME_CHECK_CALLER());
+       #else
+        juce::ignoreUnused(what);
+       #endif
+    }
+
+    void noteAllocation(size_t size, const void* caller)
+    {
+        record(ViolationType::allocation, size, nullptr, caller);
+    }
+
+    void noteDeallocation(const void* caller)
+    {
+        record(ViolationType::deallocation, 0, nullptr, caller);
+    }
+
+    void setAssertOnViolation(bool shouldAssert)
+    {
+        assertOnViolation = shouldAssert;
+    }
+
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    Violation getViolation(int index)
+    {
+        jassert(index >= 0 && index < juce::jmin(getNumViolations(), maxRecordedViolations));
+        return violations[(size_t) index];
+    }
+
+    void resetViolations()
+    {
+        numViolations = 0;
+    }
+
+    juce::String describe(const Violation& violation)
+    {
+        juce::String text;
+        switch (violation.type)
+        {
+        case ViolationType::allocation:   text << "Allocation of " << (int) violation.size << " bytes"; break;
+        case ViolationType::deallocation: text << "Deallocation"; break;
+        case ViolationType::blockingCall: text << "Blocking call " << violation.what; break;
+        default: break;
+        }
+
+        if (violation.outerSection != nullptr)
+            text << " in " << violation.outerSection << "/" << violation.section;
+        else if (violation.section != nullptr)
+            text << " in " << violation.section;
+
+        text << " from 0x" << juce::String::toHexString((juce::pointer_sized_int) violation.caller);
+        return text;
+    }
+
+    //==============================================================================
+    namespace
+    {
+        // Host stand-in that reports a playing transport at the position set before each block
+        struct HarnessPlayHead : public juce::AudioPlayHead
+        {
+            juce::Optional<PositionInfo> getPosition() const override { return info; }
+            PositionInfo info;
+        };
+    }
+
+    bool runScore(const juce::File& midiFile, const juce::Array<Player>& players,
+                  double sampleRate, int blockSize, juce::String& report)
+    {
+        auto score = ScoreCompiler::compile(midiFile);
+        if (score == nullptr || score->getNumOnsets() == 0)
+        {
+            report = "Could not load " + midiFile.getFileName();
+            return false;
+        }
+
+        AdaptiveMetronomeAudioProcessor processor;
+        processor.UpdatePlayers(players);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.loadScore(midiFile);
+
+        // User players tap exactly on their nominal onsets
+        TempoMap tempoMap = score->tempoMap;
+        tempoMap.prepare(sampleRate);
+
+        std::vector<std::pair<juce::int64, int>> taps;
+        juce::int64 endSample = 0;
+        for (int onset = 0; onset < score->getNumOnsets(); ++onset)
+        {
+            auto onsetSample = (juce::int64) tempoMap.tickToSample(score->onsets[(size_t) onset].tick);
+            for (const auto& player : players)
+                if (player.getIsUser() && score->hasChannel(onset, player.getMidiChannel()))
+                    taps.push_back({ onsetSample, player.getMidiChannel() });
+        }
+
+        for (const auto& note : score->notes)
+            endSample = juce::jmax(endSample, (juce::int64) tempoMap.tickToSample(note.offTick));
+        endSample += (juce::int64) sampleRate;  // A second of tail for late computer players
+
+        HarnessPlayHead playHead;
+        playHead.info.setIsPlaying(true);
+        processor.setPlayHead(&playHead);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(65536);
+
+        bool shouldAssert = assertOnViolation.exchange(false);
+        resetViolations();
+
+        size_t nextTap = 0;
+        for (juce::int64 position = 0; position < endSample; position += blockSize)
+        {
+            buffer.clear();
+            midi.clear();
+            for (; nextTap < taps.size() && taps[nextTap].first < position + blockSize; ++nextTap)
+                midi.addEvent(juce::MidiMessage::noteOn(taps[nextTap].second, 60, (juce::uint8) 100),
+                              (int) juce::jmax((juce::int64) 0, taps[nextTap].first - position));
+
+            playHead.info.setTimeInSamples(position);
+            processor.processBlock(buffer, midi);
+        }
+
+        processor.releaseResources();
+        processor.setPlayHead(nullptr);
+        assertOnViolation = shouldAssert;
+
+        int count = getNumViolations();
+        report = juce::String(count) + " real-time violations in " + juce::String(endSample / blockSize) + " blocks";
+        for (int i = 0; i < juce::jmin(count, maxRecordedViolations); ++i)
+            report << "\n" << describe(getViolation(i));
+
+        return count == 0;
+    }
+}
+
+//==============================================================================
+// Global allocation hooks. The default nothrow and array forms forward to these, aligned or not
+#if ADAPTIVE_METRONOME_REALTIME_CHECKS
+void* operator new(std::size_t size)
+{
+    RealtimeCheck::noteAllocation(size, REALTIME_CHECK_CALLER());
+
+    if (void* pointer = std::malloc(size > 0 ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeCheck::noteDeallocation(REALTIME_CHECK_CALLER());
+
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+// The over-aligned forms, used for alignas types such as the statistics' per-player counters.
+// Their memory comes from the platform's aligned allocator, so it is freed there too
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    RealtimeCheck::noteAllocation(size, REALTIME_CHECK_CALLER());
+
+    auto alignmentBytes = juce::jmax((std::size_t) alignment, sizeof(void*));
+    void* pointer = nullptr;
+   #if defined(_MSC_VER)
+    pointer = _aligned_malloc(size > 0 ? size : 1, alignmentBytes);
+   #else
+    if (posix_memalign(&pointer, alignmentBytes, size > 0 ? size : 1) != 0)
+        pointer = nullptr;
+   #endif
+
+    if (pointer != nullptr)
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeCheck::noteDeallocation(REALTIME_CHECK_CALLER());
+
+   #if defined(_MSC_VER)
+    _aligned_free(pointer);
+   #else
+    std::free(pointer);
+   #endif
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+#endif
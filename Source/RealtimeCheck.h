@@ -0,0 +1,84 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Player.h"
+
+// Real-time checks are on in debug builds unless the project defines this to 0
+#ifndef ADAPTIVE_METRONOME_REALTIME_CHECKS
+ #define ADAPTIVE_METRONOME_REALTIME_CHECKS JUCE_DEBUG
+#endif
+
+//==============================================================================
+// RealtimeCheck - debug/test instrumentation that catches real-time violations.
+// While a thread is marked as the audio thread, the global operator new/delete replacements
+// in RealtimeCheck.cpp (plain, array and over-aligned) record every heap allocation and free,
+// and noteBlockingCall() records blocking operations such as taking a lock. Each violation stores the innermost sections that
+// were active and the caller's address as its stack identifier, in a fixed table so recording
+// never allocates itself.
+//
+// In release builds (ADAPTIVE_METRONOME_REALTIME_CHECKS == 0) everything here compiles away.
+namespace RealtimeCheck
+{
+    enum class ViolationType
+    {
+        allocation,
+        deallocation,
+        blockingCall
+    };
+
+    struct Violation
+    {
+        ViolationType type;
+        size_t size;            // Bytes requested, for allocations
+        const char* section;    // Innermost section active on the audio thread
+        const char* outerSection;
+        const char* what;       // Name passed to noteBlockingCall
+        const void* caller;     // Return address of the offending call
+    };
+
+    static constexpr int maxRecordedViolations = 64;
+
+    // Marks the calling thread as the audio thread for the lifetime of the object
+    class ScopedAudioThread
+    {
+    public:
+        explicit ScopedAudioThread(const char* sectionName);
+        ~ScopedAudioThread();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioThread)
+    };
+
+    // Names a nested region of audio-thread code so violations can be traced back to it
+    class ScopedSection
+    {
+    public:
+        explicit ScopedSection(const char* sectionName);
+        ~ScopedSection();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedSection)
+    };
+
+    bool isAudioThread();
+
+    // Call at the top of anything that may block (locks, file access, message-thread only code)
+    void noteBlockingCall(const char* what);
+
+    // Called by the operator new/delete replacements
+    void noteAllocation(size_t size, const void* caller);
+    void noteDeallocation(const void* caller);
+
+    // Assert (in addition to recording) as soon as a violation happens. On by default
+    void setAssertOnViolation(bool shouldAssert);
+
+    int getNumViolations();
+    Violation getViolation(int index);     // Only the first maxRecordedViolations are kept
+    void resetViolations();
+    juce::String describe(const Violation& violation);
+
+    //==============================================================================
+    // Drives a fresh processor through the whole score with the given players, tapping for
+    // the user players on their nominal onsets, with the processBlock calls marked as the audio
+    // thread. Returns true if no violation was recorded; report receives a summary either way
+    bool runScore(const juce::File& midiFile, const juce::Array<Player>& players,
+                  double sampleRate, int blockSize, juce::String& report);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+
+//==============================================================================
+// SchedulingStatistics - how well the computer players keep to their schedule, so predictive
+// and reactive scheduling can be compared on the same performance.
+//
+// Prediction error is each user tap less the onset the model predicted for it. Response
+// latency is how far past its send time each computer onset actually went out, which is where
+// waiting for a user shows up. Late corrections are the predictive steps a tap then adjusted.
+//
+// Written by the audio thread only, read from anywhere with getSnapshot().
+class SchedulingStatistics
+{
+public:
+    struct Snapshot
+    {
+        juce::int64 numPredictions = 0;
+        double meanPredictionErrorMs = 0.0;
+        double predictionErrorSDMs = 0.0;
+        double maxPredictionErrorMs = 0.0;      // Largest magnitude
+
+        juce::int64 numComputerOnsets = 0;
+        juce::int64 numLateOnsets = 0;          // Sent after their send time
+        double meanResponseLatencyMs = 0.0;     // Over all computer onsets
+        double maxResponseLatencyMs = 0.0;
+
+        juce::int64 numPredictiveSteps = 0;     // Steps taken before every user had tapped
+        juce::int64 numLateCorrections = 0;     // Taps that arrived after their step
+        juce::int64 numClampedCorrections = 0;  // Computer onsets moved by less than the tap asked
+        juce::int64 numMissedCorrections = 0;   // Computer onsets already sent when the tap arrived
+    };
+
+    // Audio thread
+    void addPredictionError(double errorMs)
+    {
+        // Welford, with a single writer so load/store is enough
+        auto count = numPredictions.load(std::memory_order_relaxed) + 1;
+        auto mean = predictionMean.load(std::memory_order_relaxed);
+        auto delta = errorMs - mean;
+        mean += delta / (double) count;
+        predictionM2.store(predictionM2.load(std::memory_order_relaxed) + delta * (errorMs - mean), std::memory_order_relaxed);
+        predictionMean.store(mean, std::memory_order_relaxed);
+        numPredictions.store(count, std::memory_order_relaxed);
+        storeMax(maxPredictionError, std::abs(errorMs));
+    }
+
+    void addComputerOnset(double latencyMs)
+    {
+        increment(numComputerOnsets);
+        if (latencyMs <= 0.0)
+            return;
+
+        increment(numLateOnsets);
+        latencySumMs.store(latencySumMs.load(std::memory_order_relaxed) + latencyMs, std::memory_order_relaxed);
+        storeMax(maxLatencyMs, latencyMs);
+    }
+
+    void addPredictiveStep() { increment(numPredictiveSteps); }
+
+    void addLateCorrection(int numClamped, int numMissed)
+    {
+        increment(numLateCorrections);
+        numClampedCorrections.store(numClampedCorrections.load(std::memory_order_relaxed) + numClamped, std::memory_order_relaxed);
+        numMissedCorrections.store(numMissedCorrections.load(std::memory_order_relaxed) + numMissed, std::memory_order_relaxed);
+    }
+
+    // Not to be called while the audio thread is adding
+    void reset()
+    {
+        for (auto* counter : { &numPredictions, &numComputerOnsets, &numLateOnsets, &numPredictiveSteps,
+                               &numLateCorrections, &numClampedCorrections, &numMissedCorrections })
+            counter->store(0);
+
+        for (auto* value : { &predictionMean, &predictionM2, &maxPredictionError, &latencySumMs, &maxLatencyMs })
+            value->store(0.0);
+    }
+
+    Snapshot getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.numPredictions = numPredictions.load(std::memory_order_relaxed);
+        snapshot.meanPredictionErrorMs = predictionMean.load(std::memory_order_relaxed);
+        snapshot.predictionErrorSDMs = snapshot.numPredictions > 1
+                                           ? std::sqrt(predictionM2.load(std::memory_order_relaxed) / (double) (snapshot.numPredictions - 1)) : 0.0;
+        snapshot.maxPredictionErrorMs = maxPredictionError.load(std::memory_order_relaxed);
+        snapshot.numComputerOnsets = numComputerOnsets.load(std::memory_order_relaxed);
+        snapshot.numLateOnsets = numLateOnsets.load(std::memory_order_relaxed);
+        snapshot.meanResponseLatencyMs = snapshot.numComputerOnsets > 0
+                                             ? latencySumMs.load(std::memory_order_relaxed) / (double) snapshot.numComputerOnsets : 0.0;
+        snapshot.maxResponseLatencyMs = maxLatencyMs.load(std::memory_order_relaxed);
+        snapshot.numPredictiveSteps = numPredictiveSteps.load(std::memory_order_relaxed);
+        snapshot.numLateCorrections = numLateCorrections.load(std::memory_order_relaxed);
+        snapshot.numClampedCorrections = numClampedCorrections.load(std::memory_order_relaxed);
+        snapshot.numMissedCorrections = numMissedCorrections.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+private:
+    static void increment(std::atomic<juce::int64>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void storeMax(std::atomic<double>& maximum, double value)
+    {
+        if (value > maximum.load(std::memory_order_relaxed))
+            maximum.store(value, std::memory_order_relaxed);
+    }
+
+    std::atomic<juce::int64> numPredictions { 0 }, numComputerOnsets { 0 }, numLateOnsets { 0 }, numPredictiveSteps { 0 },
+                             numLateCorrections { 0 }, numClampedCorrections { 0 }, numMissedCorrections { 0 };
+    std::atomic<double> predictionMean { 0.0 }, predictionM2 { 0.0 }, maxPredictionError { 0.0 },
+                        latencySumMs { 0.0 }, maxLatencyMs { 0.0 };
+};
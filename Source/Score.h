@@ -0,0 +1,177 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+#include "TempoMap.h"
+#include "TraceLog.h"
+
+// A single note of the score, in MIDI ticks
+struct ScoreNote
+{
+    double tick;
+    double offTick;
+    int channel;
+    int noteNumber;
+    juce::uint8 velocity;
+};
+
+// A musical onset of the score - the model is evaluated once per onset.
+// Its notes are notes[firstNote] to notes[firstNote + numNotes - 1], sorted by channel
+struct ScoreOnset
+{
+    double tick;
+    int firstNote;
+    int numNotes;
+    juce::uint16 channelMask;   // Bit (channel - 1) set for every channel with a note here
+};
+
+// Contiguous run of notes, usable in a range-based for
+struct NoteRange
+{
+    const ScoreNote* first = nullptr;
+    const ScoreNote* last = nullptr;
+
+    const ScoreNote* begin() const { return first; }
+    const ScoreNote* end() const { return last; }
+    int size() const { return (int) (last - first); }
+};
+
+//==============================================================================
+// CompiledScore - the flat, read-only tables built from a MIDI file when it is loaded.
+// Nothing in here depends on the sample rate or on the player configuration.
+class CompiledScore : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<CompiledScore>;
+
+    TempoMap tempoMap;                // Tick <-> seconds; prepared per instance for samples
+    std::vector<ScoreNote> notes;     // Grouped by onset, then sorted by channel
+    std::vector<ScoreOnset> onsets;   // Sorted by tick
+
+    double chordToleranceMs = 0.0;    // Notes closer than this were grouped into one onset
+
+    int getNumOnsets() const { return (int) onsets.size(); }
+    double getOnsetBeats(int index) const { return tempoMap.tickToBeats(onsets[(size_t) index].tick); }
+
+    // False for anything outside MIDI channels 1-16, such as a player left on channel 0
+    bool hasChannel(int onsetIndex, int channel) const
+    {
+        if (channel < 1 || channel > 16)
+            return false;
+        return (onsets[(size_t) onsetIndex].channelMask & (1u << (channel - 1))) != 0;
+    }
+
+    // The notes one channel plays at an onset
+    NoteRange getChannelNotes(int onsetIndex, int channel) const
+    {
+        const auto& onset = onsets[(size_t) onsetIndex];
+        if (!hasChannel(onsetIndex, channel))
+            return {};
+
+        const ScoreNote* first = notes.data() + onset.firstNote;
+        const ScoreNote* last = first + onset.numNotes;
+        while (first->channel != channel)
+            ++first;
+
+        const ScoreNote* end = first;
+        while (end != last && end->channel == channel)
+            ++end;
+
+        return { first, end };
+    }
+};
+
+//==============================================================================
+// ScoreCompiler - turns a MIDI file into a CompiledScore. Runs on the message thread.
+// Notes starting within chordToleranceMs of the first note of an onset are grouped into that
+// onset, so chords and slightly spread entries cost one model evaluation instead of one per note.
+class ScoreCompiler
+{
+public:
+    static constexpr double defaultChordToleranceMs = 30.0;
+
+    static CompiledScore::Ptr compile(const juce::MidiFile& midiFile, double chordToleranceMs = defaultChordToleranceMs)
+    {
+        TraceLog::ScopedTrace trace("compileScore", "score");
+        CompiledScore::Ptr score = new CompiledScore();
+        juce::MidiMessageSequence metaEvents;
+
+        for (int t = 0; t < midiFile.getNumTracks(); ++t)
+        {
+            // Work on a copy so note-offs can be matched without touching the file
+            juce::MidiMessageSequence track(*midiFile.getTrack(t));
+            track.updateMatchedPairs();
+
+            for (auto* event : track)
+            {
+                const auto& message = event->message;
+
+                if (message.isTempoMetaEvent() || message.isTimeSignatureMetaEvent())
+                {
+                    metaEvents.addEvent(message);
+                }
+                else if (message.isNoteOn())
+                {
+                    double tick = message.getTimeStamp();
+                    double offTick = event->noteOffObject != nullptr ? event->noteOffObject->message.getTimeStamp() : tick;
+                    score->notes.push_back({ tick, offTick, message.getChannel(), message.getNoteNumber(), message.getVelocity() });
+                }
+            }
+        }
+
+        metaEvents.sort();
+        score->tempoMap.build(metaEvents, midiFile.getTimeFormat());
+
+        std::stable_sort(score->notes.begin(), score->notes.end(), [](const ScoreNote& a, const ScoreNote& b)
+            {
+                return a.tick < b.tick || (a.tick == b.tick && a.channel < b.channel);
+            });
+
+        groupOnsets(*score, chordToleranceMs);
+        return score;
+    }
+
+    static CompiledScore::Ptr compile(const juce::File& file, double chordToleranceMs = defaultChordToleranceMs)
+    {
+        juce::FileInputStream inputStream(file);
+        juce::MidiFile midiFile;
+
+        if (!inputStream.openedOk() || !midiFile.readFrom(inputStream))
+            return nullptr;
+
+        return compile(midiFile, chordToleranceMs);
+    }
+
+private:
+    // Splits the tick-sorted notes into onsets and sorts each onset's notes by channel
+    static void groupOnsets(CompiledScore& score, double chordToleranceMs)
+    {
+        auto& notes = score.notes;
+        double toleranceSeconds = chordToleranceMs * 0.001;
+
+        score.chordToleranceMs = chordToleranceMs;
+        score.onsets.clear();
+
+        int first = 0;
+        while (first < (int) notes.size())
+        {
+            double startSeconds = score.tempoMap.tickToSeconds(notes[(size_t) first].tick);
+            int last = first + 1;
+            while (last < (int) notes.size() && score.tempoMap.tickToSeconds(notes[(size_t) last].tick) - startSeconds <= toleranceSeconds)
+                ++last;
+
+            std::stable_sort(notes.begin() + first, notes.begin() + last, [](const ScoreNote& a, const ScoreNote& b)
+                {
+                    return a.channel < b.channel;
+                });
+
+            juce::uint16 channelMask = 0;
+            for (int i = first; i < last; ++i)
+                channelMask |= (juce::uint16) (1u << (notes[(size_t) i].channel - 1));
+
+            score.onsets.push_back({ notes[(size_t) first].tick, first, last - first, channelMask });
+            first = last;
+        }
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+#include "Score.h"
+#include "ScoreOverview.h"
+
+//==============================================================================
+// ScoreCache - one CompiledScore per distinct MIDI file in the process, shared by every plugin
+// instance that loads it. A template with a dozen instances on the same score parses it once and
+// holds one copy of its tables; each instance only keeps its own prepared TempoMap and model.
+//
+// Scores are keyed by a hash of the file's contents and the chord tolerance, so the same score
+// saved under two names is shared and a file edited since it was loaded is compiled again. A
+// score is freed when the last instance holding it calls release().
+//
+// Each newly compiled score's ScoreOverview is built on the cache's worker thread, while the
+// instance that loaded it goes on to build its model, and is shared like the score.
+//
+// Held through juce::SharedResourcePointer<ScoreCache>, so the cache itself goes when the last
+// instance does. Called from the message thread, or from several threads at once by the offline
+// renderer; never from the audio thread.
+class ScoreCache
+{
+public:
+    ScoreCache() = default;
+
+    // The shared score for the file, compiled the first time it is asked for. nullptr if the file
+    // cannot be read or is not a MIDI file
+    CompiledScore::Ptr acquire(const juce::File& file, double chordToleranceMs)
+    {
+        juce::MemoryBlock data;
+        if (!file.loadFileAsData(data))
+            return nullptr;
+
+        Key key { hashBytes(data.getData(), data.getSize()), (juce::int64) data.getSize(), chordToleranceMs };
+
+        {
+            const juce::ScopedLock lock(cacheLock);
+            if (auto* entry = find(key))
+            {
+                ++numHits;
+                return entry->score;
+            }
+        }
+
+        // Compiled outside the lock so other scores can be fetched meanwhile. If another thread
+        // compiled the same file first, its score is used and this one is dropped
+        juce::MemoryInputStream inputStream(data, false);
+        juce::MidiFile midiFile;
+        if (!midiFile.readFrom(inputStream))
+            return nullptr;
+
+        auto score = ScoreCompiler::compile(midiFile, chordToleranceMs);
+
+        const juce::ScopedLock lock(cacheLock);
+        if (auto* entry = find(key))
+        {
+            ++numHits;
+            return entry->score;
+        }
+
+        entries.push_back({ key, score, nullptr });
+
+        // The job holds the score while it builds, and frees it if every instance let go meanwhile
+        overviewPool.addJob([this, scoreToBuild = score]() mutable
+            {
+                CompiledScore::Ptr built;
+                std::swap(built, scoreToBuild);
+                auto overview = ScoreOverview::build(*built);
+
+                const juce::ScopedLock overviewLock(cacheLock);
+                for (auto& entry : entries)
+                    if (entry.score.get() == built.get())
+                        entry.overview = overview;
+
+                built = nullptr;
+                removeUnused();
+            });
+
+        return score;
+    }
+
+    // Drops the caller's reference and frees every score no one else holds any more
+    void release(CompiledScore::Ptr& score)
+    {
+        const juce::ScopedLock lock(cacheLock);
+        score = nullptr;
+        removeUnused();
+    }
+
+    // The score's overview, or nullptr while it is still being built
+    ScoreOverview::Ptr getOverview(const CompiledScore& score) const
+    {
+        const juce::ScopedLock lock(cacheLock);
+        for (const auto& entry : entries)
+            if (entry.score.get() == &score)
+                return entry.overview;
+
+        return nullptr;
+    }
+
+    int getNumScores() const
+    {
+        const juce::ScopedLock lock(cacheLock);
+        return (int) entries.size();
+    }
+
+    // Loads served without compiling, since the cache was created
+    int getNumHits() const
+    {
+        const juce::ScopedLock lock(cacheLock);
+        return numHits;
+    }
+
+private:
+    struct Key
+    {
+        juce::uint64 hash;
+        juce::int64 size;
+        double chordToleranceMs;
+
+        bool operator==(const Key& other) const
+        {
+            return hash == other.hash && size == other.size && chordToleranceMs == other.chordToleranceMs;
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        CompiledScore::Ptr score;
+        ScoreOverview::Ptr overview;
+    };
+
+    // 64-bit FNV-1a
+    static juce::uint64 hashBytes(const void* data, size_t size)
+    {
+        auto hash = (juce::uint64) 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<const juce::uint8*>(data)[i];
+            hash *= (juce::uint64) 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    // Called under the lock. The cache's own reference is the last one; new ones are only handed out under the lock
+    void removeUnused()
+    {
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry)
+            {
+                return entry.score->getReferenceCount() == 1;
+            }), entries.end());
+    }
+
+    // A handful of scores at most, so a linear search
+    Entry* find(const Key& key)
+    {
+        for (auto& entry : entries)
+            if (entry.key == key)
+                return &entry;
+
+        return nullptr;
+    }
+
+    juce::CriticalSection cacheLock;
+    std::vector<Entry> entries;
+    int numHits = 0;
+    juce::ThreadPool overviewPool { 1 };    // Last, so it finishes its jobs before the entries go
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScoreCache)
+};
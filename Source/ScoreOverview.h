@@ -0,0 +1,173 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "Score.h"
+#include "TraceLog.h"
+
+//==============================================================================
+// ScoreOverview - a level-of-detail pyramid of each channel's notes over the whole score, so a
+// piano roll of any length can be drawn at any zoom in time proportional to the pixels shown.
+//
+// Level 0 splits the score into bins of a fixed number of ticks. Each bin holds how much of it
+// is covered by notes (1 for one note held throughout, more for chords) and the lowest and
+// highest note sounding in it. Every level above halves the resolution, so a view picks the
+// level whose bins are just narrower than a pixel and reads one or two bins per column.
+//
+// Built once from a CompiledScore off the message thread, then read-only.
+class ScoreOverview : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ScoreOverview>;
+
+    static constexpr int numChannels = 16;
+    static constexpr int binsPerQuarterNote = 16;
+    static constexpr int maxBins = 1 << 18;     // Coarser bins for scores longer than this
+
+    struct Cell
+    {
+        float occupancy = 0.0f;         // Note time in the bin over the bin's length
+        juce::uint8 lowestNote = 127;
+        juce::uint8 highestNote = 0;
+
+        bool isEmpty() const { return highestNote < lowestNote; }
+
+        // The busier of the two over the range of both
+        void add(const Cell& other)
+        {
+            occupancy = juce::jmax(occupancy, other.occupancy);
+            lowestNote = juce::jmin(lowestNote, other.lowestNote);
+            highestNote = juce::jmax(highestNote, other.highestNote);
+        }
+    };
+
+    static Ptr build(const CompiledScore& score)
+    {
+        TraceLog::ScopedTrace trace("buildScoreOverview", "score");
+        Ptr overview = new ScoreOverview();
+
+        double endTick = 0.0;
+        for (const auto& note : score.notes)
+            endTick = juce::jmax(endTick, note.offTick);
+
+        auto ticksPerQuarterNote = score.tempoMap.getTicksPerQuarterNote();
+        overview->ticksPerBin = ticksPerQuarterNote / binsPerQuarterNote;
+        while (endTick / overview->ticksPerBin >= (double) maxBins)
+            overview->ticksPerBin *= 2.0;
+
+        overview->ticksPerQuarterNote = ticksPerQuarterNote;
+        overview->numBins = (int) (endTick / overview->ticksPerBin) + 1;
+
+        for (const auto& note : score.notes)
+            overview->addNote(note);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            overview->buildLevels(channel);
+
+        overview->onsetQuarterNotes.reserve(score.onsets.size());
+        for (const auto& onset : score.onsets)
+            overview->onsetQuarterNotes.push_back(onset.tick / ticksPerQuarterNote);
+
+        return overview;
+    }
+
+    double getLengthQuarterNotes() const { return numBins * getQuarterNotesPerBin(0); }
+    double getQuarterNotesPerBin(int level) const { return ticksPerBin / ticksPerQuarterNote * (double) (1 << level); }
+
+    bool hasChannel(int channel) const { return channel >= 1 && channel <= numChannels && !levels[(size_t) channel - 1].empty(); }
+
+    // Every note the channel plays, as one cell
+    Cell getChannelRange(int channel) const
+    {
+        return hasChannel(channel) ? levels[(size_t) channel - 1].back().front() : Cell();
+    }
+
+    // The coarsest level with bins no wider than quarterNotesPerPixel
+    int getLevelFor(int channel, double quarterNotesPerPixel) const
+    {
+        if (!hasChannel(channel))
+            return 0;
+
+        int level = 0;
+        int numLevels = (int) levels[(size_t) channel - 1].size();
+        while (level + 1 < numLevels && getQuarterNotesPerBin(level + 1) <= quarterNotesPerPixel)
+            ++level;
+        return level;
+    }
+
+    // Everything the channel plays from start to end, in quarter notes, combined from the bins of one level
+    Cell getCell(int channel, int level, double start, double end) const
+    {
+        Cell cell;
+        if (!hasChannel(channel))
+            return cell;
+
+        const auto& bins = levels[(size_t) channel - 1][(size_t) level];
+        auto binLength = getQuarterNotesPerBin(level);
+        auto first = juce::jmax(0, (int) std::floor(start / binLength));
+        auto last = juce::jmin((int) bins.size(), (int) std::ceil(end / binLength));
+
+        for (int i = first; i < last; ++i)
+            cell.add(bins[(size_t) i]);
+        return cell;
+    }
+
+    // Score onsets in quarter notes, for placing played onsets
+    const std::vector<double>& getOnsetQuarterNotes() const { return onsetQuarterNotes; }
+
+private:
+    ScoreOverview() = default;
+
+    void addNote(const ScoreNote& note)
+    {
+        if (note.channel < 1 || note.channel > numChannels)
+            return;
+
+        auto& channelLevels = levels[(size_t) note.channel - 1];
+        if (channelLevels.empty())
+            channelLevels.emplace_back((size_t) numBins);
+
+        auto& bins = channelLevels.front();
+        auto start = note.tick / ticksPerBin;
+        auto end = juce::jmax(note.offTick / ticksPerBin, start + 1.0e-3);     // Zero length notes still show
+        auto noteNumber = (juce::uint8) juce::jlimit(0, 127, note.noteNumber);
+
+        for (auto bin = (int) start; bin < juce::jmin(numBins, (int) std::ceil(end)); ++bin)
+        {
+            auto& cell = bins[(size_t) bin];
+            cell.occupancy += (float) (juce::jmin(end, bin + 1.0) - juce::jmax(start, (double) bin));
+            cell.lowestNote = juce::jmin(cell.lowestNote, noteNumber);
+            cell.highestNote = juce::jmax(cell.highestNote, noteNumber);
+        }
+    }
+
+    // Halves each level until one bin covers the whole score
+    void buildLevels(int channel)
+    {
+        auto& channelLevels = levels[(size_t) channel];
+        while (!channelLevels.empty() && channelLevels.back().size() > 1)
+        {
+            const auto& below = channelLevels.back();
+            std::vector<Cell> level((below.size() + 1) / 2);
+            for (size_t i = 0; i < below.size(); ++i)
+            {
+                // Occupancy is averaged, so a sparse passage stays faint however far out the view is
+                auto& cell = level[i / 2];
+                cell.occupancy += 0.5f * below[i].occupancy;
+                cell.lowestNote = juce::jmin(cell.lowestNote, below[i].lowestNote);
+                cell.highestNote = juce::jmax(cell.highestNote, below[i].highestNote);
+            }
+
+            channelLevels.push_back(std::move(level));
+        }
+    }
+
+    double ticksPerQuarterNote = 960.0;
+    double ticksPerBin = 60.0;
+    int numBins = 0;
+    std::array<std::vector<std::vector<Cell>>, numChannels> levels;    // Per channel, level 0 first; empty for unused channels
+    std::vector<double> onsetQuarterNotes;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScoreOverview)
+};
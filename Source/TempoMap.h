@@ -0,0 +1,216 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+//==============================================================================
+// TempoMap - piecewise-constant tempo map built once when a score is compiled.
+// Every segment holds the prefix-summed start time of all segments before it, so
+// converting a tick never rescans the tempo meta-events: random access is a binary
+// search over the segments and a Cursor moving forward is O(1) amortised.
+class TempoMap
+{
+public:
+    struct Segment
+    {
+        double startTick;       // Tick at which this tempo takes effect
+        double startSeconds;    // Prefix sum of all earlier segments
+        double secondsPerTick;
+        double startSample;     // startSeconds at the prepared sample rate
+        double samplesPerTick;  // secondsPerTick at the prepared sample rate
+    };
+
+    struct TimeSignature
+    {
+        double tick;
+        int numerator;
+        int denominator;
+    };
+
+    // Builds the segments from the score's tempo and time signature meta-events.
+    // timeFormat is the value returned by juce::MidiFile::getTimeFormat()
+    void build(const juce::MidiMessageSequence& metaEvents, short timeFormat)
+    {
+        segments.clear();
+        timeSignatures.clear();
+
+        if (timeFormat > 0)
+        {
+            ticksPerQuarterNote = timeFormat;
+
+            // MIDI files default to 120 bpm until the first tempo event
+            segments.push_back({ 0.0, 0.0, 0.5 / ticksPerQuarterNote, 0.0, 0.0 });
+
+            for (auto* event : metaEvents)
+            {
+                const auto& message = event->message;
+                if (!message.isTempoMetaEvent())
+                    continue;
+
+                double tick = message.getTimeStamp();
+                double secondsPerTick = message.getTempoSecondsPerQuarterNote() / ticksPerQuarterNote;
+                auto& last = segments.back();
+
+                // A later event at the same tick replaces the tempo rather than adding an empty segment
+                if (tick <= last.startTick)
+                {
+                    last.secondsPerTick = secondsPerTick;
+                    continue;
+                }
+
+                double startSeconds = last.startSeconds + (tick - last.startTick) * last.secondsPerTick;
+                segments.push_back({ tick, startSeconds, secondsPerTick, 0.0, 0.0 });
+            }
+        }
+        else
+        {
+            // SMPTE time: ticks are a fixed fraction of a second and tempo events do not change timing
+            int framesPerSecond = -(timeFormat >> 8);
+            int ticksPerFrame = timeFormat & 0xff;
+            double frameRate = framesPerSecond == 29 ? 29.97 : (double) framesPerSecond;
+            double secondsPerTick = 1.0 / (frameRate * ticksPerFrame);
+
+            // Beats are only nominal here, so treat a quarter note as 120 bpm
+            ticksPerQuarterNote = 0.5 / secondsPerTick;
+            segments.push_back({ 0.0, 0.0, secondsPerTick, 0.0, 0.0 });
+        }
+
+        for (auto* event : metaEvents)
+        {
+            const auto& message = event->message;
+            if (!message.isTimeSignatureMetaEvent())
+                continue;
+
+            int numerator = 4, denominator = 4;
+            message.getTimeSignatureInfo(numerator, denominator);
+            timeSignatures.push_back({ message.getTimeStamp(), numerator, denominator });
+        }
+
+        if (timeSignatures.empty() || timeSignatures.front().tick > 0.0)
+            timeSignatures.insert(timeSignatures.begin(), { 0.0, 4, 4 });
+
+        // Keep the sample positions valid if the map is rebuilt after prepare()
+        double rate = sampleRate;
+        sampleRate = 0.0;
+        if (rate > 0.0)
+            prepare(rate);
+    }
+
+    // Recomputes the sample-domain prefix sums. Does nothing if the rate has not changed
+    void prepare(double newSampleRate)
+    {
+        if (newSampleRate == sampleRate)
+            return;
+
+        sampleRate = newSampleRate;
+        for (auto& segment : segments)
+        {
+            segment.startSample = segment.startSeconds * sampleRate;
+            segment.samplesPerTick = segment.secondsPerTick * sampleRate;
+        }
+    }
+
+    bool isEmpty() const { return segments.empty(); }
+    double getSampleRate() const { return sampleRate; }
+    double getTicksPerQuarterNote() const { return ticksPerQuarterNote; }
+    const std::vector<Segment>& getSegments() const { return segments; }
+
+    // Random access conversions - O(log n) in the number of tempo changes
+    double tickToSeconds(double tick) const
+    {
+        const auto& segment = segments[(size_t) findSegmentForTick(tick)];
+        return segment.startSeconds + (tick - segment.startTick) * segment.secondsPerTick;
+    }
+
+    double tickToSample(double tick) const
+    {
+        const auto& segment = segments[(size_t) findSegmentForTick(tick)];
+        return segment.startSample + (tick - segment.startTick) * segment.samplesPerTick;
+    }
+
+    double sampleToTick(double sample) const
+    {
+        const auto& segment = segments[(size_t) findSegmentForSample(sample)];
+        return segment.startTick + (sample - segment.startSample) / segment.samplesPerTick;
+    }
+
+    double tickToBeats(double tick) const { return tick / ticksPerQuarterNote; }
+
+    // Seconds per quarter note in effect at the given tick
+    double getSecondsPerQuarterNoteAt(double tick) const
+    {
+        return segments[(size_t) findSegmentForTick(tick)].secondsPerTick * ticksPerQuarterNote;
+    }
+
+    const TimeSignature& getTimeSignatureAt(double tick) const
+    {
+        auto it = std::upper_bound(timeSignatures.begin(), timeSignatures.end(), tick,
+            [](double t, const TimeSignature& sig) { return t < sig.tick; });
+        return *(it == timeSignatures.begin() ? it : it - 1);
+    }
+
+    int findSegmentForTick(double tick) const
+    {
+        jassert(!segments.empty());
+        auto it = std::upper_bound(segments.begin() + 1, segments.end(), tick,
+            [](double t, const Segment& segment) { return t < segment.startTick; });
+        return (int) (it - segments.begin()) - 1;
+    }
+
+    int findSegmentForSample(double sample) const
+    {
+        jassert(!segments.empty());
+        auto it = std::upper_bound(segments.begin() + 1, segments.end(), sample,
+            [](double s, const Segment& segment) { return s < segment.startSample; });
+        return (int) (it - segments.begin()) - 1;
+    }
+
+    //==============================================================================
+    // Cursor for playback: remembers the current segment so a monotonically moving
+    // position only ever steps forward. Jumping backwards falls back to a binary search.
+    class Cursor
+    {
+    public:
+        Cursor() = default;
+        explicit Cursor(const TempoMap& tempoMap) : map(&tempoMap) {}
+
+        void reset(const TempoMap& tempoMap) { map = &tempoMap; index = 0; }
+
+        double tickToSample(double tick)
+        {
+            const auto& segments = map->segments;
+            if (tick < segments[(size_t) index].startTick)
+                index = map->findSegmentForTick(tick);
+            else
+                while (index + 1 < (int) segments.size() && segments[(size_t) index + 1].startTick <= tick)
+                    ++index;
+
+            const auto& segment = segments[(size_t) index];
+            return segment.startSample + (tick - segment.startTick) * segment.samplesPerTick;
+        }
+
+        double sampleToTick(double sample)
+        {
+            const auto& segments = map->segments;
+            if (sample < segments[(size_t) index].startSample)
+                index = map->findSegmentForSample(sample);
+            else
+                while (index + 1 < (int) segments.size() && segments[(size_t) index + 1].startSample <= sample)
+                    ++index;
+
+            const auto& segment = segments[(size_t) index];
+            return segment.startTick + (sample - segment.startSample) / segment.samplesPerTick;
+        }
+
+    private:
+        const TempoMap* map = nullptr;
+        int index = 0;
+    };
+
+private:
+    std::vector<Segment> segments;
+    std::vector<TimeSignature> timeSignatures;
+    double ticksPerQuarterNote = 960.0;
+    double sampleRate = 0.0;
+};
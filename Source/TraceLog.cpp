@@ -0,0 +1,295 @@
+#include "TraceLog.h"
+#include <array>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace TraceLog
+{
+    namespace
+    {
+        constexpr int maxThreads = 16;
+        constexpr int eventsPerThread = 8192;    // Power of two - 256 KB per thread
+
+        struct Event
+        {
+            const char* name;
+            const char* category;
+            juce::int64 startNs;
+            juce::int64 durationNs;     // -1 for instant events
+        };
+
+        constexpr juce::uint64 freeClaim = 0;
+        constexpr juce::uint64 sweptClaim = ~(juce::uint64) 0;     // Taken back, waiting for a write in progress
+
+        // Single writer (the thread whose claim it holds), any number of readers
+        struct ThreadBuffer
+        {
+            std::array<Event, eventsPerThread> events;
+            std::atomic<juce::uint64> numWritten { 0 };
+            std::atomic<const char*> threadName { nullptr };
+            std::atomic<juce::uint64> claim { freeClaim };
+            std::atomic<bool> writing { false };    // Around each write, so a sweep never takes the buffer mid-write
+        };
+
+        std::atomic<bool> enabled { false };
+        std::atomic<int> numClaimed { 0 };          // Buffers ever handed out, up to maxThreads
+        std::atomic<int> numUntracedThreads { 0 };  // Threads that found every buffer taken
+        std::atomic<ThreadBuffer*> pool { nullptr };
+        std::atomic<juce::uint64> clearedBefore[maxThreads] = {};
+        std::atomic<juce::uint64> nextClaim { 1 };
+        std::atomic<int> numSweeps { 0 };
+        juce::uint64 writtenAtSweep[maxThreads] = {};   // Message thread only
+
+        // Plain data, so a thread's first trace does not register a thread exit destructor,
+        // which allocates. Buffers come back through sweep() instead
+        struct ThreadClaim
+        {
+            ThreadBuffer* buffer;
+            juce::uint64 claim;
+            int exhaustedAtSweep;   // numSweeps when the pool was last found full, or -1
+        };
+
+        thread_local ThreadClaim threadClaim { nullptr, freeClaim, -1 };
+
+        // A buffer no thread has used yet if there is one, otherwise one a sweep took back. A
+        // reused buffer starts empty, so the previous thread's events go with it
+        ThreadBuffer* claimBuffer(ThreadBuffer* buffers, juce::uint64 claim)
+        {
+            for (int index = numClaimed.load(); index < maxThreads; index = numClaimed.load())
+            {
+                if (numClaimed.compare_exchange_weak(index, index + 1))
+                {
+                    buffers[index].claim.store(claim);
+                    return buffers + index;
+                }
+            }
+
+            for (int index = 0; index < maxThreads; ++index)
+            {
+                auto& buffer = buffers[index];
+                auto expected = freeClaim;
+                if (buffer.claim.compare_exchange_strong(expected, claim))
+                {
+                    buffer.threadName.store(nullptr, std::memory_order_relaxed);
+                    clearedBefore[index] = buffer.numWritten.load(std::memory_order_relaxed);
+                    return &buffer;
+                }
+            }
+
+            return nullptr;
+        }
+
+        // The calling thread's buffer, marked as being written to until endWrite(), or nullptr
+        ThreadBuffer* beginWrite()
+        {
+            for (;;)
+            {
+                if (auto* buffer = threadClaim.buffer)
+                {
+                    // Sequentially consistent with sweep(): either it sees this write or this sees its claim go
+                    buffer->writing.store(true);
+                    if (buffer->claim.load() == threadClaim.claim)
+                        return buffer;
+
+                    buffer->writing.store(false);
+                    threadClaim.buffer = nullptr;
+                }
+
+                int sweeps = numSweeps.load();
+                if (threadClaim.exhaustedAtSweep == sweeps)
+                    return nullptr;
+
+                auto* buffers = pool.load(std::memory_order_acquire);
+                if (buffers == nullptr)
+                    return nullptr;
+
+                auto claim = nextClaim++;
+                threadClaim.buffer = claimBuffer(buffers, claim);
+                threadClaim.claim = claim;
+                if (threadClaim.buffer == nullptr)
+                {
+                    if (threadClaim.exhaustedAtSweep < 0)
+                        ++numUntracedThreads;
+                    threadClaim.exhaustedAtSweep = sweeps;
+                    return nullptr;
+                }
+            }
+        }
+
+        void endWrite(ThreadBuffer* buffer)
+        {
+            buffer->writing.store(false, std::memory_order_release);
+        }
+
+        // Takes back the buffers nothing was written to since the last sweep, from threads that
+        // have exited or gone quiet. A quiet thread claims a buffer again when it next traces
+        void sweep(ThreadBuffer* buffers)
+        {
+            for (int t = 0; t < juce::jmin(numClaimed.load(), maxThreads); ++t)
+            {
+                auto& buffer = buffers[t];
+                auto written = buffer.numWritten.load(std::memory_order_acquire);
+                bool idle = written == writtenAtSweep[t];
+                writtenAtSweep[t] = written;
+
+                auto claim = buffer.claim.load();
+                if (!idle || claim == freeClaim || !buffer.claim.compare_exchange_strong(claim, sweptClaim))
+                    continue;
+
+                while (buffer.writing.load())
+                    std::this_thread::yield();
+
+                buffer.claim.store(freeClaim);
+            }
+
+            ++numSweeps;
+        }
+
+        void writeJsonString(juce::OutputStream& out, const char* text)
+        {
+            out << "\"";
+            for (const char* c = text; c != nullptr && *c != 0; ++c)
+            {
+                if (*c == '"' || *c == '\\')
+                    out << "\\";
+                out.writeByte(*c);
+            }
+            out << "\"";
+        }
+    }
+
+    void setEnabled(bool shouldBeEnabled)
+    {
+        // The pool is created once, off the audio thread, and kept for the life of the process.
+        // Threads hold on to their buffers until they exit
+        if (shouldBeEnabled && pool.load() == nullptr)
+        {
+            static std::unique_ptr<ThreadBuffer[]> storage(new ThreadBuffer[maxThreads]);
+            pool = storage.get();
+        }
+
+        enabled = shouldBeEnabled;
+    }
+
+    bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char* threadName)
+    {
+        if (!isEnabled())
+            return;
+
+        if (auto* buffer = beginWrite())
+        {
+            buffer->threadName.store(threadName, std::memory_order_relaxed);
+            endWrite(buffer);
+        }
+    }
+
+    juce::int64 getTimeNs()
+    {
+        // JUCE's high resolution ticks are only microseconds on some systems
+        auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+        return (juce::int64) std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch).count();
+    }
+
+    void addEvent(const char* name, const char* category, juce::int64 startNs, juce::int64 durationNs)
+    {
+        auto* buffer = beginWrite();
+        if (buffer == nullptr)
+            return;
+
+        auto index = buffer->numWritten.load(std::memory_order_relaxed);
+        buffer->events[(size_t) (index & (eventsPerThread - 1))] = { name, category, startNs, durationNs };
+        buffer->numWritten.store(index + 1, std::memory_order_release);
+        endWrite(buffer);
+    }
+
+    void instant(const char* name, const char* category)
+    {
+        if (isEnabled())
+            addEvent(name, category, getTimeNs(), -1);
+    }
+
+    void clear()
+    {
+        auto* buffers = pool.load();
+        if (buffers == nullptr)
+            return;
+
+        sweep(buffers);
+        for (int t = 0; t < juce::jmin(numClaimed.load(), maxThreads); ++t)
+            clearedBefore[t] = buffers[t].numWritten.load(std::memory_order_acquire);
+    }
+
+    bool writeChromeTrace(const juce::File& file)
+    {
+        auto* buffers = pool.load();
+        if (buffers != nullptr)
+            sweep(buffers);
+
+        file.deleteFile();
+        juce::FileOutputStream out(file);
+        if (!out.openedOk())
+            return false;
+
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&out, &first] { out << (first ? "" : ",\n"); first = false; };
+
+        // Threads that started while every buffer was taken are missing from the trace, so say so
+        if (auto numUntraced = numUntracedThreads.load(); numUntraced > 0)
+        {
+            separator();
+            out << "{\"name\":";
+            writeJsonString(out, juce::String(juce::String(numUntraced) + " threads not traced, all "
+                                              + juce::String(maxThreads) + " thread buffers in use").toRawUTF8());
+            out << ",\"cat\":\"trace\",\"ph\":\"i\",\"pid\":1,\"tid\":0,\"ts\":"
+                << juce::String((double) getTimeNs() / 1000.0, 3) << ",\"s\":\"g\"}";
+        }
+
+        for (int t = 0; buffers != nullptr && t < juce::jmin(numClaimed.load(), maxThreads); ++t)
+        {
+            auto& buffer = buffers[t];
+
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":";
+            auto* threadName = buffer.threadName.load();
+            writeJsonString(out, threadName != nullptr ? threadName : juce::String("Thread " + juce::String(t)).toRawUTF8());
+            out << "}}";
+
+            // Only the events the writer cannot have overwritten while they were being copied
+            auto end = buffer.numWritten.load(std::memory_order_acquire);
+            auto begin = juce::jmax(clearedBefore[t].load(), end > (juce::uint64) eventsPerThread ? end - eventsPerThread : 0);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                Event event = buffer.events[(size_t) (i & (eventsPerThread - 1))];
+                if (buffer.numWritten.load(std::memory_order_acquire) - i > (juce::uint64) eventsPerThread)
+                    continue;
+
+                separator();
+                out << "{\"name\":";
+                writeJsonString(out, event.name);
+                out << ",\"cat\":";
+                writeJsonString(out, event.category);
+                out << ",\"ph\":\"" << (event.durationNs < 0 ? "i" : "X") << "\",\"pid\":1,\"tid\":" << t
+                    << ",\"ts\":" << juce::String((double) event.startNs / 1000.0, 3);
+
+                if (event.durationNs >= 0)
+                    out << ",\"dur\":" << juce::String((double) event.durationNs / 1000.0, 3);
+                else
+                    out << ",\"s\":\"t\"";
+
+                out << "}";
+            }
+        }
+
+        out << "\n]}\n";
+        out.flush();
+        return true;
+    }
+}
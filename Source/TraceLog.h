@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+//==============================================================================
+// TraceLog - lightweight timeline tracing that can be switched on in any build.
+// Each thread writes its events into its own fixed ring buffer, claimed from a pool that is
+// allocated the first time tracing is enabled, so recording is wait-free and never allocates.
+// Clearing and saving take back the buffers of threads that have exited, or traced nothing
+// since the last time; threads that find the pool full are not traced until then, and the
+// trace notes how many there were.
+// When disabled a ScopedTrace costs one relaxed atomic load.
+//
+// writeChromeTrace() dumps the buffers as Chrome trace JSON, which chrome://tracing and the
+// Perfetto UI both open.
+namespace TraceLog
+{
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled();
+
+    // Name shown for the calling thread's track (the pointer must stay valid)
+    void setThreadName(const char* threadName);
+
+    // A named point in time on the calling thread
+    void instant(const char* name, const char* category = "");
+
+    // Writes every buffered event as Chrome trace JSON. Safe while other threads keep tracing
+    bool writeChromeTrace(const juce::File& file);
+
+    // Discards everything recorded so far
+    void clear();
+
+    juce::int64 getTimeNs();
+    void addEvent(const char* name, const char* category, juce::int64 startNs, juce::int64 durationNs);
+
+    // Records the lifetime of the object as one complete event
+    class ScopedTrace
+    {
+    public:
+        explicit ScopedTrace(const char* eventName, const char* eventCategory = "")
+            : name(eventName), category(eventCategory), startNs(isEnabled() ? getTimeNs() : -1) {}
+
+        ~ScopedTrace()
+        {
+            if (startNs >= 0)
+                addEvent(name, category, startNs, getTimeNs() - startNs);
+        }
+
+    private:
+        const char* name;
+        const char* category;
+        juce::int64 startNs;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedTrace)
+    };
+}